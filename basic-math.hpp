@@ -16,26 +16,26 @@ typedef int32_t fpixels;
 const fixed FIXMAX = 32768;
 const fixed FIXHALF = 16384;
 
-fixed fixed_mul(fixed a, fixed b) {
+constexpr fixed fixed_mul(fixed a, fixed b) {
     int32_t ia = a;
     int32_t ib = b;
     return (ia * ib) >> 15;
 }
 
-fixed fixed_lerp_fast(fixed a, fixed b, fixed t) {
+constexpr fixed fixed_lerp_fast(fixed a, fixed b, fixed t) {
     int32_t ia = a;
     int32_t ib = b;
     int32_t it = t;
     return (ib * it + ia * (FIXMAX - it)) >> 15;
 }
 
-fixed fixed_clamp(int32_t x) {
+constexpr fixed fixed_clamp(int32_t x) {
     if (x < 0) { return 0; }
     if (x > FIXMAX) { return FIXMAX; }
     return x;
 }
 
-fixed fixed_sqr(fixed x) {
+constexpr fixed fixed_sqr(fixed x) {
     return (x * x) >> 15;
 }
 
@@ -51,20 +51,94 @@ int32_t fpixels_round_down(fpixels x) {
     return x >> 6;
 }
 
+// Reciprocals
+//
+// A divide takes 2 to 12 cycles on the SAMD51, depending on the
+// operands, and the per-pixel code used to do a lot of them.  A
+// Reciprocal is a precomputed inverse of a divisor, so that dividing by
+// it is a multiply and a shift.  Building one costs a count of leading
+// zeros, a table lookup and an interpolation, so it pays off when it's
+// used for several divides, as in UnlerpStepper, more clearly than when
+// it's used once.  The benchmarks print each kernel next to the divide
+// it replaced.
+//
+// The inverse comes from a table of 2^31 / x, for x from 256 to 512.
+// The divisor is normalized into that range using a count of leading
+// zeros, and the table is interpolated.  Every table entry is rounded
+// up, and interpolating a convex curve overestimates, so the inverse is
+// never too small.  It is too large by at most 4.2 parts per million.
+// So as long as the quotient is below 2^17, the result is never less
+// than the exact quotient, rounded down, and at most 1 more.  Dividing
+// by zero gives zero, like the hardware divide.
+//
+
+#define RECIP_TABLE_BITS 8
+#define RECIP_TABLE_ENTRIES ((1 << RECIP_TABLE_BITS) + 1)
+
+struct RecipTable {
+    uint32_t entry[RECIP_TABLE_ENTRIES];
+
+    constexpr RecipTable() : entry() {
+        for (int i = 0; i < RECIP_TABLE_ENTRIES; i++) {
+            uint32_t x = (1 << RECIP_TABLE_BITS) + i;
+            entry[i] = ((uint32_t(1) << 31) + x - 1) / x;
+        }
+    }
+};
+
+constexpr RecipTable recip_table;
+
+struct Reciprocal {
+    uint32_t mul_;
+    int shift_;
+
+    constexpr Reciprocal(uint32_t d) : mul_(0), shift_(0) {
+        if (d == 0) return;
+        int z = __builtin_clz(d);
+        uint32_t dn = d << z;
+        uint32_t index = (dn >> (31 - RECIP_TABLE_BITS)) & ((1 << RECIP_TABLE_BITS) - 1);
+        uint32_t frac = (dn >> (15 - RECIP_TABLE_BITS)) & 0xFFFF;
+        uint32_t lo = recip_table.entry[index];
+        uint32_t hi = recip_table.entry[index + 1];
+        mul_ = lo - (((lo - hi) * frac) >> 16);
+        shift_ = 54 - z;
+    }
+
+    // divide
+    //
+    // n / d.
+
+    constexpr uint32_t divide(uint32_t n) const {
+        return (uint64_t(n) * mul_) >> shift_;
+    }
+
+    // scale
+    //
+    // n * FIXMAX / d.
+
+    constexpr uint32_t scale(uint32_t n) const {
+        return (uint64_t(n) * mul_) >> (shift_ - 15);
+    }
+};
+
 // This version of fixed_lerp can handle full-sized ints.
 //
 int32_t fixed_lerp(int32_t a, int32_t b, fixed t) {
-    int32_t divisor = FIXMAX;
+    int shift = 15;
     while ((a > FIXMAX) || (b > FIXMAX) || (a < -FIXMAX) || (b < -FIXMAX)) {
-        if (divisor == 1) break;
+        if (shift == 0) break;
         a>>=1;
         b>>=1;
-        divisor>>=1;
+        shift--;
     }
-    return (b * t + a * (FIXMAX - t)) / divisor;
+    // Divide by 2^shift, rounding toward zero, like a divide would.
+    int32_t x = b * t + a * (FIXMAX - t);
+    if (x < 0) x += (1 << shift) - 1;
+    return x >> shift;
 }
 
-// This version of fixed_unlerp can handle full-sized ints.
+// This version of fixed_unlerp can handle full-sized ints.  It uses a
+// Reciprocal, so it is within 1 of the exact (t - a) * FIXMAX / (b - a).
 //
 fixed fixed_unlerp(int32_t a, int32_t b, int32_t t) {
     int32_t n = (t - a);
@@ -79,11 +153,102 @@ fixed fixed_unlerp(int32_t a, int32_t b, int32_t t) {
     if (n >= d) {
         return FIXMAX;
     }
-    while (n > FIXMAX) {
-        n >>= 1;
-        d >>= 1;
+    return Reciprocal(d).scale(n);
+}
+
+// UnlerpStepper
+//
+// Computes fixed_unlerp(a, b, t) for t = t0, t0 + dt, t0 + 2*dt, and
+// so on, for loops over pixels.  The reciprocal is computed once, and
+// each step is an add and a shift.  The results are exactly the same as
+// fixed_unlerp's.
+//
+
+struct UnlerpStepper {
+    int64_t acc_;
+    int64_t step_;
+    int shift_;
+
+    UnlerpStepper(int32_t a, int32_t b, int32_t t0, int32_t dt) {
+        int32_t n = (t0 - a);
+        int32_t d = (b - a);
+        if (d < 0) {
+            d = -d;
+            n = -n;
+            dt = -dt;
+        }
+        if (d == 0) {
+            // Anything past a is FIXMAX.
+            acc_ = int64_t(n) << 32;
+            step_ = int64_t(dt) << 32;
+            shift_ = 0;
+            return;
+        }
+        Reciprocal r(d);
+        acc_ = int64_t(n) * r.mul_;
+        step_ = int64_t(dt) * r.mul_;
+        shift_ = r.shift_ - 15;
+    }
+
+    fixed next() {
+        int64_t v = acc_ >> shift_;
+        acc_ += step_;
+        if (v <= 0) return 0;
+        if (v >= FIXMAX) return FIXMAX;
+        return v;
     }
-    return n * FIXMAX / d;
+};
+
+// Range-typed fixed point
+//
+// Fixed<Bits, Range> is an int32 with Bits fraction bits, whose raw
+// value is known to lie between -Range and +Range.  Since the range is
+// part of the type, operations can pick their path at compile time.
+// fixed_lerp on values within FIXMAX is a single multiply-add and
+// shift; wider values take the normalizing loop of the untyped version.
+// Sums and differences widen the range, and lerps preserve it.
+// fixed_unlerp and UnlerpStepper have no loop to skip, so they take a
+// Fixed through the conversion to int32_t.
+//
+// The untyped fixed and fpixels keep working.  A Fixed converts to
+// int32_t implicitly, so it can be passed to untyped code.  Converting
+// the other way is explicit and unchecked: the caller promises that the
+// value is in range.
+//
+
+template <int Bits, int32_t Range>
+struct Fixed {
+    static_assert((Range > 0) && (Range <= 0x3FFFFFFF), "Fixed range must be positive, and leave room for a sign and a carry.");
+
+    int32_t raw;
+
+    constexpr explicit Fixed(int32_t value) : raw(value) { }
+    constexpr operator int32_t() const { return raw; }
+};
+
+template <int32_t Range>
+using FPixels = Fixed<6, Range>;
+
+template <int Bits, int32_t R1, int32_t R2>
+constexpr Fixed<Bits, R1 + R2> operator+(Fixed<Bits, R1> a, Fixed<Bits, R2> b) {
+    return Fixed<Bits, R1 + R2>(a.raw + b.raw);
+}
+
+template <int Bits, int32_t R1, int32_t R2>
+constexpr Fixed<Bits, R1 + R2> operator-(Fixed<Bits, R1> a, Fixed<Bits, R2> b) {
+    return Fixed<Bits, R1 + R2>(a.raw - b.raw);
+}
+
+template <int Bits, int32_t R1, int32_t R2>
+inline Fixed<Bits, (R1 > R2) ? R1 : R2> fixed_lerp(Fixed<Bits, R1> a, Fixed<Bits, R2> b, fixed t) {
+    const int32_t range = (R1 > R2) ? R1 : R2;
+    if (range <= FIXMAX) {
+        // The sum is at most range * FIXMAX, which fits.  The divide is
+        // by a constant, so it is a shift, rounding toward zero like the
+        // untyped version.
+        return Fixed<Bits, range>((b.raw * t + a.raw * (FIXMAX - t)) / FIXMAX);
+    }
+    return Fixed<Bits, range>(fixed_lerp(a.raw, b.raw, t));
 }
 
 int32_t clamp(int32_t lo, int32_t hi, int32_t value) {
@@ -96,30 +261,15 @@ int32_t clamp(int32_t lo, int32_t hi, int32_t value) {
 // just multiplying and dividing is that it converts your values
 // to ints first.
 //
-int32_t muldiv(int32_t a, int32_t n, int32_t d) {
+constexpr int32_t muldiv(int32_t a, int32_t n, int32_t d) {
     return (a * n) / d;
 }
 
-int pick_one(int p0, int p1, int p2, int p3, int p4, int p5, int p6, int p7, int p8, int p9) {
-    switch(random(10)) {
-        case 0: return p0;
-        case 1: return p1;
-        case 2: return p2;
-        case 3: return p3;
-        case 4: return p4;
-        case 5: return p5;
-        case 6: return p6;
-        case 7: return p7;
-        case 8: return p8;
-        case 9: return p9;
-    }
-}
-
 // Splining routines
 //
 // Interpolate between a sequence of values.
 
-fixed spline2(fixed i, fixed p0, fixed p1, fixed p2) {
+constexpr fixed spline2(fixed i, fixed p0, fixed p1, fixed p2) {
     uint32_t ix = i * 2;
     uint32_t offset = ix & 0x7FFF;
     switch (ix >> 15) {
@@ -129,7 +279,7 @@ fixed spline2(fixed i, fixed p0, fixed p1, fixed p2) {
     }
 }
 
-fixed spline4(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4) {
+constexpr fixed spline4(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4) {
     uint32_t ix = i * 4;
     uint32_t offset = ix & 0x7FFF;
     switch (ix >> 15) {
@@ -141,7 +291,7 @@ fixed spline4(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4) {
     }
 }
 
-fixed spline6(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4, fixed p5, fixed p6) {
+constexpr fixed spline6(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4, fixed p5, fixed p6) {
     uint32_t ix = i * 6;
     uint32_t offset = ix & 0x7FFF;
     switch (ix >> 15) {
@@ -155,7 +305,7 @@ fixed spline6(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4, fixed p
     }
 }
 
-fixed spline8(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4, fixed p5, fixed p6, fixed p7, fixed p8) {
+constexpr fixed spline8(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4, fixed p5, fixed p6, fixed p7, fixed p8) {
     uint32_t ix = i * 8;
     uint32_t offset = ix & 0x7FFF;
     switch (ix >> 15) {
@@ -171,8 +321,8 @@ fixed spline8(fixed i, fixed p0, fixed p1, fixed p2, fixed p3, fixed p4, fixed p
     }
 }
 
-fixed a_ramp(fixed i, int narrow) {
-    uint32_t offset;
+constexpr fixed a_ramp(fixed i, int narrow) {
+    uint32_t offset = 0;
     if (i > 16384) {
         offset = i - 16384;
     } else {
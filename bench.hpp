@@ -0,0 +1,809 @@
+// Microbenchmarks
+//
+// Measures the cost of the fixed-point math and color primitives.  Each
+// benchmark runs one primitive over a table of inputs, many times, and
+// reports cycles per operation and nanoseconds per operation.  The
+// inputs are chosen to resemble what the effects actually feed these
+// functions: full hue sweeps, saturated and partially saturated colors,
+// and so forth.
+//
+// The loop overhead (loading the inputs and accumulating the result) is
+// measured separately and subtracted, so the numbers reflect the cost of
+// the primitive itself.  The overhead is measured several times, and a
+// primitive that costs less than the spread is reported as below the
+// noise floor rather than as a number.  Results are approximate: the
+// compiler may schedule a primitive differently in a benchmark loop
+// than in an effect.
+//
+// The checks compare the fast paths with the code they replaced, and
+// return the number of failures.  run_benchmarks returns the total, and
+// the host build exits with an error if it isn't zero.
+//
+// To run the benchmarks on the target, define BENCHMARK at the top of
+// the sketch.  They run once, at the end of setup().  To run them on a
+// workstation, use 'make bench' in the host directory.  On the host,
+// cycles are F_CPU cycles derived from the elapsed time, not host cycles.
+//
+
+#ifdef BENCHMARK
+
+#define BENCH_INPUTS 256
+#define BENCH_ROUNDS 64
+#define BENCH_OPS (BENCH_INPUTS * BENCH_ROUNDS)
+#define BENCH_BASELINE_RUNS 8
+
+struct BenchInputs {
+    fixed a[BENCH_INPUTS];
+    fixed b[BENCH_INPUTS];
+    fixed t[BENCH_INPUTS];
+    fixed hue[BENCH_INPUTS];
+    fixed sat[BENCH_INPUTS];
+    int32_t small_lo[BENCH_INPUTS];
+    int32_t small_hi[BENCH_INPUTS];
+    int32_t large_lo[BENCH_INPUTS];
+    int32_t large_hi[BENCH_INPUTS];
+    RGB c1[BENCH_INPUTS];
+    RGB c2[BENCH_INPUTS];
+};
+
+BenchInputs bench_inputs;
+Rainbow bench_rainbow;
+RainbowPalette bench_palette;
+uint32_t bench_neocolors[BENCH_INPUTS];
+Prng bench_prng(12345, 0);
+volatile uint32_t bench_sink;
+uint32_t bench_baseline;
+uint32_t bench_noise;
+
+// A private generator, so that the inputs are the same every run.
+
+uint32_t bench_random(uint32_t &state, uint32_t n) {
+    state = state * 1664525 + 1013904223;
+    return uint32_t((uint64_t(state) * n) >> 32);
+}
+
+void bench_generate_inputs() {
+    BenchInputs &in = bench_inputs;
+    uint32_t state = 12345;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        in.a[i] = bench_random(state, FIXMAX + 1);
+        in.b[i] = bench_random(state, FIXMAX + 1);
+        in.t[i] = bench_random(state, FIXMAX + 1);
+        // A full sweep of the hue wheel.
+        in.hue[i] = (i * FIXMAX) / BENCH_INPUTS;
+        // Half the saturations are FIXMAX, the rest are partial.
+        in.sat[i] = (i & 1) ? FIXMAX : bench_random(state, FIXMAX);
+        // Comet and car positions, in fpixels.
+        in.small_lo[i] = -int32_t(bench_random(state, 10 * 64));
+        in.small_hi[i] = pixels_to_fpixels(LEDS_PER_EDGE) + bench_random(state, 64);
+        // Large enough to hit the normalization loops.
+        in.large_lo[i] = int32_t(bench_random(state, 1 << 20)) - (1 << 19);
+        in.large_hi[i] = in.large_lo[i] + 40000 + bench_random(state, 1 << 20);
+        in.c1[i] = hue_sat(in.hue[i], in.sat[i]);
+        in.c2[i] = RGB(bench_random(state, FIXMAX + 1), bench_random(state, FIXMAX + 1), bench_random(state, FIXMAX + 1));
+        bench_neocolors[i] = in.c2[i].neocolor_unsafe();
+    }
+    bench_rainbow.clear();
+    RGB black(0, 0, 0);
+    RGB color1 = hue_sat(HUE_RED, FIXMAX).brighten();
+    RGB color2 = hue_sat(HUE_BLUE, FIXMAX).brighten();
+    bench_rainbow.add_range(3, black, black);
+    bench_rainbow.add_range(2, black, color1);
+    bench_rainbow.add_range(3, color1, color2);
+    bench_rainbow.add_range(2, color2, black);
+    bench_rainbow.bake(bench_palette);
+}
+
+uint32_t rgb_sum(const RGB &c) {
+    return c.R + c.G + c.B;
+}
+
+// bench_cycles
+//
+// Run the operation over all the inputs, BENCH_ROUNDS times.  Return
+// the number of cycles it took.
+
+template <typename Op>
+uint32_t bench_cycles(Op op) {
+    uint32_t sink = 0;
+    uint32_t start = cycle_count();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        // Keep the compiler from hoisting work out of the rounds loop.
+        __asm__ __volatile__("" : : : "memory");
+        for (int i = 0; i < BENCH_INPUTS; i++) {
+            sink += op(i);
+        }
+    }
+    uint32_t cycles = cycle_count() - start;
+    bench_sink += sink;
+    return cycles;
+}
+
+// bench_measure_baseline
+//
+// Time the loop with a trivial operation, several times.  The fastest
+// run is the overhead that bench subtracts, and the spread between the
+// fastest and the slowest is the noise.
+
+void bench_measure_baseline() {
+    const BenchInputs &in = bench_inputs;
+    uint32_t lo = UINT32_MAX;
+    uint32_t hi = 0;
+    for (int k = 0; k < BENCH_BASELINE_RUNS; k++) {
+        uint32_t cycles = bench_cycles([&](int i) { return in.a[i] ^ in.b[i]; });
+        if (cycles < lo) lo = cycles;
+        if (cycles > hi) hi = cycles;
+    }
+    bench_baseline = lo;
+    bench_noise = hi - lo;
+}
+
+template <typename Op>
+void bench(const char *name, Op op) {
+    uint32_t cycles = bench_cycles(op);
+    if (cycles <= bench_baseline + bench_noise) {
+        uint32_t noise_x100 = uint64_t(bench_noise) * 100 / BENCH_OPS;
+        Serial.printf("  %-28s below the noise floor, %d.%02d cycles/op\n", name,
+            int(noise_x100 / 100), int(noise_x100 % 100));
+        return;
+    }
+    cycles -= bench_baseline;
+    uint32_t cycles_x100 = uint64_t(cycles) * 100 / BENCH_OPS;
+    uint32_t ns_x100 = uint64_t(cycles) * 100000 / (F_CPU / 1000000) / BENCH_OPS;
+    Serial.printf("  %-28s %6d.%02d cycles/op %6d.%02d ns/op\n", name,
+        int(cycles_x100 / 100), int(cycles_x100 % 100),
+        int(ns_x100 / 100), int(ns_x100 % 100));
+}
+
+// bench_span
+//
+// Run an operation that processes all the inputs at once, BENCH_ROUNDS
+// times, and report the cost per pixel.
+
+template <typename Op>
+uint32_t bench_span_cycles(Op op) {
+    uint32_t start = cycle_count();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        __asm__ __volatile__("" : : : "memory");
+        op();
+    }
+    return cycle_count() - start;
+}
+
+template <typename Op>
+void bench_span(const char *name, Op op) {
+    uint32_t cycles = bench_span_cycles(op);
+    uint32_t cycles_x100 = uint64_t(cycles) * 100 / BENCH_OPS;
+    uint32_t ns_x100 = uint64_t(cycles) * 100000 / (F_CPU / 1000000) / BENCH_OPS;
+    Serial.printf("  %-28s %6d.%02d cycles/px %6d.%02d ns/px\n", name,
+        int(cycles_x100 / 100), int(cycles_x100 % 100),
+        int(ns_x100 / 100), int(ns_x100 % 100));
+}
+
+// bench_versus, bench_span_versus
+//
+// Run a division-free kernel and the divide it replaced, back to back,
+// and print the two costs on one row, with the kernel's cost as a
+// percentage of the divide's.  These are the rows to read from a
+// BENCHMARK build on the target; on the host, they only show that the
+// kernels aren't pathologically slow.
+
+void bench_print_versus(const char *name, uint32_t kernel, uint32_t divide, const char *unit) {
+    uint32_t kernel_x100 = uint64_t(kernel) * 100 / BENCH_OPS;
+    uint32_t divide_x100 = uint64_t(divide) * 100 / BENCH_OPS;
+    Serial.printf("  %-28s %6d.%02d vs %6d.%02d cycles/%s", name,
+        int(kernel_x100 / 100), int(kernel_x100 % 100),
+        int(divide_x100 / 100), int(divide_x100 % 100), unit);
+    if (divide_x100 > 0) {
+        Serial.printf(", %d%%\n", int(uint64_t(kernel_x100) * 100 / divide_x100));
+    } else {
+        Serial.printf("\n");
+    }
+}
+
+template <typename Kernel, typename Divide>
+void bench_versus(const char *name, Kernel kernel, Divide divide) {
+    uint32_t k = bench_cycles(kernel);
+    uint32_t d = bench_cycles(divide);
+    if ((k <= bench_baseline + bench_noise) || (d <= bench_baseline + bench_noise)) {
+        Serial.printf("  %-28s below the noise floor\n", name);
+        return;
+    }
+    bench_print_versus(name, k - bench_baseline, d - bench_baseline, "op");
+}
+
+template <typename Kernel, typename Divide>
+void bench_span_versus(const char *name, Kernel kernel, Divide divide) {
+    uint32_t k = bench_span_cycles(kernel);
+    uint32_t d = bench_span_cycles(divide);
+    bench_print_versus(name, k, d, "px");
+}
+
+// check_pixel_kernels
+//
+// Check that the pair operations match their plain C versions, on the
+// edges of the range and on random pairs, and that the pixel kernels
+// match the RGB methods exactly.  On the host the pair operations are
+// the plain C versions, so only the second half tells anything.  With
+// PIXEL_KERNELS_SIMD on the target, the first half tests the DSP
+// instructions.  Returns the number of mismatches.
+
+RGB bench_span_a[BENCH_INPUTS];
+RGB bench_span_b[BENCH_INPUTS];
+
+bool rgb_equal(const RGB &a, const RGB &b) {
+    return (a.R == b.R) && (a.G == b.G) && (a.B == b.B);
+}
+
+const uint16_t bench_pair_edges[] = { 0, 1, 2, 0x7FFF, 0x8000, 0x8001, 0xFFFE, 0xFFFF };
+
+int check_pixel_kernels() {
+    const BenchInputs &in = bench_inputs;
+    int mismatches = 0;
+    uint32_t state = 4242;
+    const int edges = sizeof(bench_pair_edges) / sizeof(bench_pair_edges[0]);
+    for (int k = 0; k < 20000; k++) {
+        uint32_t a = bench_random(state, 0xFFFFFFFF);
+        uint32_t b = bench_random(state, 0xFFFFFFFF);
+        if (k < edges * edges * edges * edges) {
+            int e = k;
+            a = bench_pair_edges[e % edges] | (uint32_t(bench_pair_edges[(e / edges) % edges]) << 16);
+            e /= edges * edges;
+            b = bench_pair_edges[e % edges] | (uint32_t(bench_pair_edges[(e / edges) % edges]) << 16);
+        }
+        if (pk_uqadd16(a, b) != pk_uqadd16_c(a, b)) mismatches++;
+        if (pk_uqsub16(a, b) != pk_uqsub16_c(a, b)) mismatches++;
+        if (pk_max16(a, b) != pk_max16_c(a, b)) mismatches++;
+        if (pk_min16(a, b) != pk_min16_c(a, b)) mismatches++;
+    }
+    for (int k = 0; k < 6; k++) {
+        memcpy(bench_span_a, in.c1, sizeof(bench_span_a));
+        switch (k) {
+        case 0: rgb_add_span(bench_span_a, in.c2, BENCH_INPUTS); break;
+        case 1: rgb_sub_span(bench_span_a, in.c2, BENCH_INPUTS); break;
+        case 2: rgb_sub_grey_span(bench_span_a, in.t[7], BENCH_INPUTS); break;
+        case 3: rgb_max_span(bench_span_a, in.c2, BENCH_INPUTS); break;
+        case 4: rgb_scale_span(bench_span_a, in.c1, in.t[3], BENCH_INPUTS); break;
+        case 5: rgb_lerp_span(bench_span_a, in.c1, in.c2, in.t[5], BENCH_INPUTS); break;
+        }
+        for (int i = 0; i < BENCH_INPUTS; i++) {
+            RGB a = in.c1[i];
+            RGB b = in.c2[i];
+            RGB expect;
+            switch (k) {
+            case 0: expect = a.add(b); break;
+            case 1: expect = a.sub(b); break;
+            case 2: expect = a.sub(RGB(in.t[7], in.t[7], in.t[7])); break;
+            case 3: expect = a.maxv(b); break;
+            case 4: expect = a.scale(in.t[3]); break;
+            case 5: expect = a.lerp(b, in.t[5]); break;
+            }
+            if (!rgb_equal(expect, bench_span_a[i])) mismatches++;
+        }
+    }
+    Serial.printf("Pixel kernels (%s): %d mismatches.\n", PIXEL_KERNELS_SIMD ? "SIMD" : "scalar", mismatches);
+    return mismatches;
+}
+
+// check_led_unpack
+//
+// Check that every byte of a neocolor survives led_unpack and
+// neocolor_unsafe unchanged.
+
+int check_led_unpack() {
+    int mismatches = 0;
+    for (uint32_t b = 0; b < 256; b++) {
+        uint32_t neocolor = (b << 16) | ((255 - b) << 8) | (b ^ 0x5A);
+        if (led_unpack(neocolor).neocolor_unsafe() != neocolor) mismatches++;
+    }
+    Serial.printf("Pre-packed writes: %d mismatches.\n", mismatches);
+    return mismatches;
+}
+
+// check_hue_sat_bright
+//
+// Report how far hue_sat_bright is from hue_sat().brighten(), over the
+// whole wheel at full saturation, and at a few partial saturations.
+// The interpolated wheel may be a few parts in 32768 off, and the
+// partial saturations must match.
+
+#define HUE_SAT_BRIGHT_TOLERANCE 4
+
+int check_hue_sat_bright() {
+    int full_error = 0;
+    int partial_error = 0;
+    for (int hue = 0; hue < FIXMAX; hue++) {
+        RGB a = hue_sat(hue, FIXMAX).brighten();
+        RGB b = hue_sat_bright(hue, FIXMAX);
+        full_error = max(full_error, max(abs(a.R - b.R), max(abs(a.G - b.G), abs(a.B - b.B))));
+        for (int sat = 0; sat < FIXMAX; sat += 4096) {
+            RGB c = hue_sat(hue, sat).brighten();
+            RGB d = hue_sat_bright(hue, sat);
+            partial_error = max(partial_error, max(abs(c.R - d.R), max(abs(c.G - d.G), abs(c.B - d.B))));
+        }
+    }
+    Serial.printf("hue_sat_bright: max error %d at full saturation, %d at partial saturation.\n",
+        full_error, partial_error);
+    return ((full_error > HUE_SAT_BRIGHT_TOLERANCE) || (partial_error > 0)) ? 1 : 0;
+}
+
+// The divides that the Reciprocal versions replaced, for comparison.
+
+int32_t divide_fixed_lerp(int32_t a, int32_t b, fixed t) {
+    int32_t divisor = FIXMAX;
+    while ((a > FIXMAX) || (b > FIXMAX) || (a < -FIXMAX) || (b < -FIXMAX)) {
+        if (divisor == 1) break;
+        a>>=1;
+        b>>=1;
+        divisor>>=1;
+    }
+    return (b * t + a * (FIXMAX - t)) / divisor;
+}
+
+fixed divide_fixed_unlerp(int32_t a, int32_t b, int32_t t) {
+    int32_t n = (t - a);
+    int32_t d = (b - a);
+    if (d < 0) {
+        d = -d;
+        n = -n;
+    }
+    if (n <= 0) return 0;
+    if (n >= d) return FIXMAX;
+    return int64_t(n) * FIXMAX / d;
+}
+
+RGB divide_brighten(const RGB &c) {
+    uint32_t m = max(c.R, max(c.G, c.B));
+    return RGB(c.R * FIXMAX / m, c.G * FIXMAX / m, c.B * FIXMAX / m);
+}
+
+uint32_t divide_neocolor_safe(const RGB &c) {
+    uint32_t total = uint32_t(c.R) + uint32_t(c.G) + uint32_t(c.B);
+    if (total <= FIXMAX) return c.neocolor_unsafe();
+    uint32_t r = (uint32_t(c.R) * (FIXMAX - 1) / total) >> 7;
+    uint32_t g = (uint32_t(c.G) * (FIXMAX - 1) / total) >> 7;
+    uint32_t b = (uint32_t(c.B) * (FIXMAX - 1) / total) >> 7;
+    return (r << 16) | (g << 8) | b;
+}
+
+int rgb_max_error(const RGB &a, const RGB &b) {
+    return max(abs(a.R - b.R), max(abs(a.G - b.G), abs(a.B - b.B)));
+}
+
+int neocolor_max_error(uint32_t a, uint32_t b) {
+    int error = 0;
+    for (int shift = 0; shift < 24; shift += 8) {
+        error = max(error, abs(int((a >> shift) & 255) - int((b >> shift) & 255)));
+    }
+    return error;
+}
+
+Vector bench_vector(int i) {
+    return dodecahedron_vertex[i % 20];
+}
+
+// check_fixed_ranges
+//
+// Check that the range-typed fast paths match the untyped versions.
+
+int check_fixed_ranges() {
+    const BenchInputs &in = bench_inputs;
+    int mismatches = 0;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        for (int k = 0; k < BENCH_INPUTS; k += 17) {
+            fixed t = in.t[k];
+            int32_t a = fixed_lerp(FPixels<1920>(in.small_lo[i]), FPixels<1920>(in.small_hi[i]), t);
+            if (a != fixed_lerp(in.small_lo[i], in.small_hi[i], t)) mismatches++;
+        }
+    }
+    Serial.printf("Range-typed fixed_lerp: %d mismatches.\n", mismatches);
+    return mismatches;
+}
+
+// check_division_free
+//
+// Report how far the division-free kernels are from the exact divides.
+// fixed_unlerp and brighten should be 0 or 1 above, never below, and
+// neocolor_safe may be 1 above.  fixed_lerp and UnlerpStepper should
+// match exactly.
+
+int check_division_free() {
+    const BenchInputs &in = bench_inputs;
+    uint32_t state = 999;
+    int unlerp_lo = 0, unlerp_hi = 0;
+    int lerp_mismatches = 0, stepper_mismatches = 0;
+    for (int i = 0; i < 100000; i++) {
+        int32_t a = int32_t(bench_random(state, 1 << 24)) - (1 << 23);
+        int32_t d = 1 + bench_random(state, (i & 1) ? 1000 : (1 << 24));
+        int32_t t = a + bench_random(state, d + 1);
+        int diff = int(fixed_unlerp(a, a + d, t)) - int(divide_fixed_unlerp(a, a + d, t));
+        unlerp_lo = min(unlerp_lo, diff);
+        unlerp_hi = max(unlerp_hi, diff);
+        fixed f = bench_random(state, FIXMAX + 1);
+        if (fixed_lerp(a, a + d, f) != divide_fixed_lerp(a, a + d, f)) lerp_mismatches++;
+        if (fixed_lerp(-a, a, f) != divide_fixed_lerp(-a, a, f)) lerp_mismatches++;
+    }
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        int32_t lo = in.small_lo[i];
+        int32_t hi = lo + pixels_to_fpixels(5 + (i % 5));
+        UnlerpStepper stepper(lo, hi, 0, pixels_to_fpixels(1));
+        for (int px = 0; px < LEDS_PER_EDGE; px++) {
+            if (stepper.next() != fixed_unlerp(lo, hi, pixels_to_fpixels(px))) stepper_mismatches++;
+        }
+    }
+    int brighten_lo = 0, brighten_hi = 0, neocolor_error = 0;
+    for (int i = 0; i < 100000; i++) {
+        RGB c(bench_random(state, FIXMAX + 1), bench_random(state, FIXMAX + 1), 1 + bench_random(state, FIXMAX));
+        RGB a = c.brighten();
+        RGB b = divide_brighten(c);
+        brighten_lo = min(brighten_lo, min(a.R - b.R, min(a.G - b.G, a.B - b.B)));
+        brighten_hi = max(brighten_hi, max(a.R - b.R, max(a.G - b.G, a.B - b.B)));
+        neocolor_error = max(neocolor_error, neocolor_max_error(c.neocolor_safe(), divide_neocolor_safe(c)));
+    }
+    Serial.printf("Division-free: fixed_unlerp %+d..%+d, brighten %+d..%+d, neocolor_safe %d, "
+        "fixed_lerp %d mismatches, UnlerpStepper %d mismatches.\n",
+        unlerp_lo, unlerp_hi, brighten_lo, brighten_hi, neocolor_error, lerp_mismatches, stepper_mismatches);
+    int failures = lerp_mismatches + stepper_mismatches;
+    if ((unlerp_lo < 0) || (unlerp_hi > 1)) failures++;
+    if ((brighten_lo < 0) || (brighten_hi > 1)) failures++;
+    if (neocolor_error > 1) failures++;
+    return failures;
+}
+
+// check_curves
+//
+// Report the max error of each curve table in the sketch, against the
+// function that it was built from, over every input, and count the
+// tables that are off.  Every table in the sketch holds exactly the
+// knots of a spline, so they should all be exact.
+
+template <typename Table, typename Curve>
+int check_curve(const char *name, const Table &table, const Curve &curve) {
+    int error = 0;
+    for (int i = 0; i <= FIXMAX; i++) {
+        error = max(error, abs(int(table(i)) - int(curve(i))));
+    }
+    Serial.printf("  %-28s max error %d\n", name, error);
+    return (error > 0) ? 1 : 0;
+}
+
+int check_curves() {
+    int failures = 0;
+    Serial.printf("Curve tables:\n");
+    failures += check_curve("comet_hotness", comet_hotness, [](fixed i) { return spline4(i, 0, FIXMAX*1/3, FIXMAX*2/3, FIXMAX*3/3, 0); });
+    failures += check_curve("zippy_car_profile", zippy_car_profile, [](fixed i) {
+        return spline8(i, 0, FIXMAX * 3 / 8, FIXMAX * 5 / 8, FIXMAX * 6 / 8, FIXMAX * 7 / 8, FIXMAX, FIXMAX, FIXMAX, 0);
+    });
+    failures += check_curve("burst_wave1", burst_wave1, [](fixed i) { return spline8(i, 0, FIXMAX/3, FIXMAX, FIXMAX/2, FIXMAX/4, FIXMAX/8, FIXMAX/12, FIXMAX/16, 0); });
+    failures += check_curve("burst_wave2", burst_wave2, [](fixed i) { return spline4(i, 0, FIXMAX/4, FIXMAX, FIXMAX/4, 0); });
+    return failures;
+}
+
+// check_geodesic
+//
+// Check that a GeodesicField, seeded with the same LEDs as each table,
+// finds the same distances, and report the farthest LED.
+
+GeodesicField bench_field;
+Particles<MAXCOMETS> bench_particles;
+
+int check_geodesic() {
+    int mismatches = 0;
+    int farthest = 0;
+    for (int s = 0; s < GEODESIC_SOURCES; s++) {
+        const uint8_t *table = (s < GEODESIC_VERTICES) ? geodesic_from_vertex(s) : geodesic_from_edge(s - GEODESIC_VERTICES);
+        bench_field.clear();
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            if (table[led] == 0) bench_field.add_source(led);
+        }
+        if (bench_field.expand() != TOTAL_LEDS) mismatches++;
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            if (bench_field.distance(led) != table[led]) mismatches++;
+            farthest = max(farthest, int(table[led]));
+        }
+    }
+    Serial.printf("Geodesic tables: %d mismatches, farthest LED %d steps.\n", mismatches, farthest);
+    return mismatches;
+}
+
+// check_symmetry
+//
+// Report how far each rotation is from rigid: the largest change in the
+// distance between two vertices, in coordinate units.  Rounding the
+// vertices accounts for a few units.  A wrong rotation is off by
+// thousands.  Also check that the full group's edge-copying scatter
+// paints the same frame as the general one.
+
+#define SYMMETRY_TOLERANCE 16
+
+int check_symmetry() {
+    int error = 0;
+    for (int g = 0; g < ROTATIONS; g++) {
+        for (int a = 0; a < DODECAHEDRON_VERTICES; a++) {
+            for (int b = 0; b < a; b++) {
+                int32_t before = vector_length(dodecahedron_vertex[a].sub(dodecahedron_vertex[b]));
+                int32_t after = vector_length(dodecahedron_vertex[rotate_vertex(g, a)].sub(dodecahedron_vertex[rotate_vertex(g, b)]));
+                error = max(error, abs(int(after - before)));
+            }
+        }
+    }
+    int mismatches = 0;
+    RGB expect[TOTAL_LEDS];
+    symmetry_scatter(full_symmetry.led_, full_symmetry.rows, full_symmetry.order, bench_inputs.c2);
+    memcpy(expect, led_frame, sizeof(expect));
+    full_symmetry.scatter(bench_inputs.c2);
+    for (int led = 0; led < TOTAL_LEDS; led++) {
+        if (!rgb_equal(expect[led], led_frame[led])) mismatches++;
+    }
+    Serial.printf("Rotations: max vertex distance error %d, full scatter %d mismatches.\n", error, mismatches);
+    return ((error > SYMMETRY_TOLERANCE) ? 1 : 0) + mismatches;
+}
+
+// check_power_limiter
+//
+// Feed one output an alternating demand, just under the budget and
+// then half again over it, and check that the long-run mean stays at
+// or under the budget.  The only slack allowed is the credit that the
+// output started with, spread over the run.  Every tenth frame is dark,
+// which banks the most credit, and the credit must stay between zero
+// and its cap.  The steps run from one frame period up to stalls long
+// enough to overflow 32-bit credit math.
+
+int check_power_limiter() {
+    const uint32_t frames = 100000;
+    const uint32_t step_counts[] = { 1, 2, 3, 4, 10, 100, 365, 1000, 100000 };
+    bool ok = true;
+    for (uint32_t steps : step_counts) {
+        LedOutputPower power;
+        power.credit = LED_OUTPUT_CREDIT;
+        power.stats.reset();
+        uint64_t total = 0;
+        for (uint32_t f = 0; f < frames; f++) {
+            uint32_t demand = (f & 1) ? (LED_OUTPUT_BURST) : (uint64_t(LED_OUTPUT_BUDGET) * 9999 / 10000);
+            if (f % 10 == 0) demand = 0;
+            fixed scale = led_output_scale(power, demand, steps);
+            total += (uint64_t(demand) * scale >> 15) * steps;
+            if ((power.credit < 0) || (power.credit > LED_OUTPUT_CREDIT)) ok = false;
+        }
+        uint64_t limit = uint64_t(LED_OUTPUT_BUDGET) * frames * steps + LED_OUTPUT_CREDIT;
+        uint32_t percent_x100 = total / (uint64_t(LED_OUTPUT_BUDGET) * frames * steps / 10000);
+        Serial.printf("  power limiter, steps=%d: mean %d.%02d%% of budget\n", int(steps),
+            int(percent_x100 / 100), int(percent_x100 % 100));
+        if (total > limit) ok = false;
+    }
+    Serial.printf("Power limiter: %s\n", ok ? "ok" : "FAILED, mean is over budget or credit is out of range");
+    return ok ? 0 : 1;
+}
+
+// check_spatial
+//
+// Check that the spatial queries select exactly the LEDs that a test of
+// every position would, for random spheres and slabs.
+
+uint16_t bench_leds[TOTAL_LEDS];
+int32_t bench_dots[TOTAL_LEDS];
+uint32_t bench_distances[TOTAL_LEDS];
+
+Vector bench_point(uint32_t &state) {
+    return Vector(int32_t(bench_random(state, 32769)) - 16384,
+                  int32_t(bench_random(state, 32769)) - 16384,
+                  int32_t(bench_random(state, 32769)) - 16384);
+}
+
+int check_spatial() {
+    uint32_t state = 54321;
+    int mismatches = 0;
+    int selected = 0;
+    for (int q = 0; q < 1000; q++) {
+        Vector p = bench_point(state);
+        int32_t r = bench_random(state, 40000);
+        int count = leds_within(bench_leds, p, r);
+        led_distance_sq_span(bench_distances, p);
+        int k = 0;
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            if (bench_distances[led] > uint32_t(r) * uint32_t(r)) continue;
+            if ((k >= count) || (bench_leds[k] != led)) mismatches++;
+            k++;
+        }
+        if (k != count) mismatches++;
+        selected += count;
+
+        Vector n = bench_point(state);
+        int32_t lo = int32_t(bench_random(state, 1 << 30)) - (1 << 29);
+        int32_t hi = lo + bench_random(state, 1 << 28);
+        count = leds_between(bench_leds, n, lo, hi);
+        led_dot_span(bench_dots, n);
+        k = 0;
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            if ((bench_dots[led] < lo) || (bench_dots[led] > hi)) continue;
+            if ((k >= count) || (bench_leds[k] != led)) mismatches++;
+            k++;
+        }
+        if (k != count) mismatches++;
+        selected += count;
+    }
+    Serial.printf("Spatial queries: %d mismatches, %d LEDs per query.\n", mismatches, selected / 2000);
+    return mismatches;
+}
+
+// run_benchmarks
+//
+// Run every benchmark and check.  Returns the number of failed checks.
+
+int run_benchmarks() {
+    const BenchInputs &in = bench_inputs;
+    cycle_counter_begin();
+    bench_generate_inputs();
+    bench_measure_baseline();
+
+    Serial.printf("Benchmarks (%d ops each, F_CPU=%d):\n", BENCH_OPS, int(F_CPU));
+    bench("fixed_mul", [&](int i) { return fixed_mul(in.a[i], in.b[i]); });
+    bench("fixed_lerp_fast", [&](int i) { return fixed_lerp_fast(in.a[i], in.b[i], in.t[i]); });
+    bench("fixed_lerp (fpixels)", [&](int i) { return fixed_lerp(in.small_lo[i], in.small_hi[i], in.t[i]); });
+    bench("fixed_lerp (large)", [&](int i) { return fixed_lerp(in.large_lo[i], in.large_hi[i], in.t[i]); });
+    bench("fixed_unlerp (fpixels)", [&](int i) { return fixed_unlerp(in.small_lo[i], in.small_hi[i], in.a[i] >> 5); });
+    bench("fixed_unlerp (large)", [&](int i) { return fixed_unlerp(in.large_lo[i], in.large_hi[i], in.large_lo[i] + in.a[i] * 8); });
+    bench("fixed_lerp (FPixels<1920>)", [&](int i) { return fixed_lerp(FPixels<1920>(in.small_lo[i]), FPixels<1920>(in.small_hi[i]), in.t[i]); });
+    bench("Reciprocal", [&](int i) { return Reciprocal(in.a[i] + 1).mul_; });
+    bench("spline4", [&](int i) { return spline4(in.t[i], 0, FIXMAX*1/3, FIXMAX*2/3, FIXMAX*3/3, 0); });
+    bench("spline8", [&](int i) { return spline8(in.t[i], 0, FIXMAX*3/8, FIXMAX*5/8, FIXMAX*6/8, FIXMAX*7/8, FIXMAX, FIXMAX, FIXMAX, 0); });
+    bench("a_ramp", [&](int i) { return a_ramp(in.t[i], i & 3); });
+    bench("CurveTable<2> (spline4)", [&](int i) { return comet_hotness(in.t[i]); });
+    bench("CurveTable<3> (spline8)", [&](int i) { return zippy_car_profile(in.t[i]); });
+    bench("hue_sat (sat=FIXMAX)", [&](int i) { return rgb_sum(hue_sat(in.hue[i], FIXMAX)); });
+    bench("hue_sat (mixed sat)", [&](int i) { return rgb_sum(hue_sat(in.hue[i], in.sat[i])); });
+    bench("hue_sat().brighten()", [&](int i) { return rgb_sum(hue_sat(in.hue[i], in.sat[i]).brighten()); });
+    bench("hue_sat_bright", [&](int i) { return rgb_sum(hue_sat_bright(in.hue[i], in.sat[i])); });
+    bench("RGB::lerp", [&](int i) { return rgb_sum(in.c1[i].lerp(in.c2[i], in.t[i])); });
+    bench("RGB::scale", [&](int i) { return rgb_sum(in.c2[i].scale(in.t[i])); });
+    bench("RGB::brighten", [&](int i) { return rgb_sum(in.c1[i].brighten()); });
+    bench("RGB::neocolor_unsafe", [&](int i) { return in.c2[i].neocolor_unsafe(); });
+    bench("RGB::neocolor_safe", [&](int i) { return in.c2[i].neocolor_safe(); });
+    bench("setPixelColor", [&](int i) { leds.setPixelColor(i, in.c2[i].neocolor_unsafe()); return 0; });
+    bench("led_write (RGB)", [&](int i) { led_write(i, in.c2[i]); return 0; });
+    bench("led_write (neocolor)", [&](int i) { led_write(i, bench_neocolors[i]); return 0; });
+    bench("gamma_lookup", [&](int i) { return gamma_lookup(in.a[i]); });
+    bench("Rainbow::get", [&](int i) { return rgb_sum(bench_rainbow.get(in.t[i])); });
+    bench("Rainbow::get().scale()", [&](int i) { return rgb_sum(bench_rainbow.get(in.t[i]).scale(in.t[0])); });
+    bench("RainbowPalette::get", [&](int i) { return rgb_sum(bench_palette.get(in.t[i])); });
+    bench_span("led_write_span (RGB)", [&]() { led_write_span(0, in.c2, BENCH_INPUTS); });
+    bench_span("led_write_span (neocolor)", [&]() { led_write_span(0, bench_neocolors, BENCH_INPUTS); });
+    bench_span("RGB::add loop", [&]() { for (int i = 0; i < BENCH_INPUTS; i++) bench_span_a[i] = bench_span_a[i].add(in.c2[i]); });
+    bench_span("rgb_add_span", [&]() { rgb_add_span(bench_span_a, in.c2, BENCH_INPUTS); });
+    bench_span("RGB::sub loop", [&]() { for (int i = 0; i < BENCH_INPUTS; i++) bench_span_a[i] = bench_span_a[i].sub(in.c2[i]); });
+    bench_span("rgb_sub_span", [&]() { rgb_sub_span(bench_span_a, in.c2, BENCH_INPUTS); });
+    bench_span("RGB::maxv loop", [&]() { for (int i = 0; i < BENCH_INPUTS; i++) bench_span_a[i] = bench_span_a[i].maxv(in.c2[i]); });
+    bench_span("rgb_max_span", [&]() { rgb_max_span(bench_span_a, in.c2, BENCH_INPUTS); });
+    bench_span("RGB::scale loop", [&]() { for (int i = 0; i < BENCH_INPUTS; i++) bench_span_b[i] = in.c2[i].scale(in.t[0]); });
+    bench_span("rgb_scale_span", [&]() { rgb_scale_span(bench_span_b, in.c2, in.t[0], BENCH_INPUTS); });
+    bench_span("RGB::lerp loop", [&]() { for (int i = 0; i < BENCH_INPUTS; i++) bench_span_b[i] = in.c1[i].lerp(in.c2[i], in.t[0]); });
+    bench_span("rgb_lerp_span", [&]() { rgb_lerp_span(bench_span_b, in.c1, in.c2, in.t[0], BENCH_INPUTS); });
+    bench_span("fixed_unlerp loop", [&]() {
+        for (int i = 0; i < BENCH_INPUTS; i += 8) {
+            for (int px = 0; px < 8; px++) bench_span_a[i + px].R = fixed_unlerp(in.small_lo[i], in.small_hi[i], pixels_to_fpixels(px));
+        }
+    });
+    bench_span("AdjacentLEDs", [&]() {
+        for (int i = 0; i < BENCH_INPUTS; i++) {
+            AdjacentLEDs adj(i / LEDS_PER_EDGE, i % LEDS_PER_EDGE);
+            bench_span_a[i].R = led_frame[adj.led[0]].R + led_frame[adj.led[1]].R + (adj.have_three() ? led_frame[adj.led[2]].R : 0);
+        }
+    });
+    bench_span("led_adjacency", [&]() {
+        for (int i = 0; i < BENCH_INPUTS; i++) {
+            const uint16_t *adj = led_adjacency.neighbors(i);
+            bench_span_a[i].R = led_frame[adj[0]].R + led_frame[adj[1]].R + ((led_adjacency.count(i) == 3) ? led_frame[adj[2]].R : 0);
+        }
+    });
+    bench("leds_within (r=2000)", [&](int i) { return leds_within(bench_leds, bench_vector(i), 2000); });
+    bench("leds_within (r=8000)", [&](int i) { return leds_within(bench_leds, bench_vector(i), 8000); });
+    bench("leds_within (scan)", [&](int i) {
+        Vector p = bench_vector(i);
+        led_distance_sq_span(bench_distances, p);
+        int count = 0;
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            if (bench_distances[led] <= 8000u * 8000u) bench_leds[count++] = led;
+        }
+        return count;
+    });
+    bench("leds_between (slab)", [&](int i) { return leds_between(bench_leds, bench_vector(i), -(1 << 26), 1 << 26); });
+    bench("leds_between (scan)", [&](int i) {
+        led_dot_span(bench_dots, bench_vector(i));
+        int count = 0;
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            if ((bench_dots[led] >= -(1 << 26)) && (bench_dots[led] <= (1 << 26))) bench_leds[count++] = led;
+        }
+        return count;
+    });
+    bench("geodesic ring (table)", [&](int i) {
+        const uint8_t *d = geodesic_from_vertex(i % GEODESIC_VERTICES);
+        int count = 0;
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            if (d[led] == (i & 63)) bench_leds[count++] = led;
+        }
+        return count;
+    });
+    bench("GeodesicField (3 sources)", [&](int i) {
+        bench_field.clear();
+        for (int k = 0; k < 3; k++) bench_field.add_source((i * 301 + k * 127) % TOTAL_LEDS);
+        return bench_field.expand();
+    });
+    bench("GeodesicField (limit 15)", [&](int i) {
+        bench_field.clear();
+        for (int k = 0; k < 3; k++) bench_field.add_source((i * 301 + k * 127) % TOTAL_LEDS);
+        return bench_field.expand(15);
+    });
+    bench("full_symmetry.scatter", [&](int i) { full_symmetry.scatter(in.c1 + (i & 127)); return led_frame[i].R; });
+    bench("full_symmetry (general)", [&](int i) {
+        symmetry_scatter(full_symmetry.led_, full_symmetry.rows, full_symmetry.order, in.c1 + (i & 127));
+        return led_frame[i].R;
+    });
+    bench("pole_symmetry.scatter", [&](int i) { pole_symmetry.scatter(in.c1 + (i & 63)); return led_frame[i].R; });
+    bench("Particles spawn+kill", [&](int i) {
+        int c = bench_particles.spawn();
+        bench_particles.kill(bench_particles.live() - 1);
+        return c;
+    });
+    bench("Particles delayed spawn", [&](int i) {
+        if (bench_particles.full()) bench_particles.clear();
+        int c = bench_particles.spawn(1 + (in.a[i] & 511));
+        bench_particles.tick(1);
+        bench_particles.release();
+        while (bench_particles.live() > 0) bench_particles.kill(0);
+        return c;
+    });
+    int failures = 0;
+    failures += check_pixel_kernels();
+    failures += check_led_unpack();
+    failures += check_hue_sat_bright();
+    failures += check_division_free();
+    failures += check_fixed_ranges();
+    failures += check_curves();
+    failures += check_power_limiter();
+    failures += check_spatial();
+    failures += check_geodesic();
+    failures += check_symmetry();
+    bench_span("hue_sat loop", [&]() { for (int i = 0; i < BENCH_INPUTS; i++) bench_span_b[i] = hue_sat(in.hue[i], in.sat[i]).scale(in.t[i]); });
+    bench_span("hsv_span", [&]() { hsv_span(bench_span_b, in.hue, in.sat, in.t, BENCH_INPUTS); });
+    bench_span("hsv_span (sat=FIXMAX)", [&]() { hsv_span(bench_span_b, in.hue, NULL, in.t, BENCH_INPUTS); });
+    bench_span("hsv_bright_span", [&]() { hsv_bright_span(bench_span_b, in.hue, in.sat, in.t, BENCH_INPUTS); });
+    bench("random(n)", [&](int i) { return random(in.a[i] + 1); });
+    bench("Prng::below", [&](int i) { return bench_prng.below(in.a[i] + 1); });
+    Serial.printf("Division-free kernels vs the divides they replaced:\n");
+    bench_versus("fixed_lerp (fpixels)",
+        [&](int i) { return fixed_lerp(in.small_lo[i], in.small_hi[i], in.t[i]); },
+        [&](int i) { return divide_fixed_lerp(in.small_lo[i], in.small_hi[i], in.t[i]); });
+    bench_versus("fixed_unlerp (fpixels)",
+        [&](int i) { return fixed_unlerp(in.small_lo[i], in.small_hi[i], in.a[i] >> 5); },
+        [&](int i) { return divide_fixed_unlerp(in.small_lo[i], in.small_hi[i], in.a[i] >> 5); });
+    bench_versus("RGB::brighten",
+        [&](int i) { return rgb_sum(in.c1[i].brighten()); },
+        [&](int i) { return rgb_sum(divide_brighten(in.c1[i])); });
+    bench_versus("RGB::neocolor_safe",
+        [&](int i) { return in.c2[i].neocolor_safe(); },
+        [&](int i) { return divide_neocolor_safe(in.c2[i]); });
+    bench_span_versus("UnlerpStepper",
+        [&]() {
+            for (int i = 0; i < BENCH_INPUTS; i += 8) {
+                UnlerpStepper stepper(in.small_lo[i], in.small_hi[i], 0, pixels_to_fpixels(1));
+                for (int px = 0; px < 8; px++) bench_span_a[i + px].R = stepper.next();
+            }
+        },
+        [&]() {
+            for (int i = 0; i < BENCH_INPUTS; i += 8) {
+                for (int px = 0; px < 8; px++) bench_span_a[i + px].R = divide_fixed_unlerp(in.small_lo[i], in.small_hi[i], pixels_to_fpixels(px));
+            }
+        });
+    bench_span_versus("Comet decay",
+        [&]() {
+            uint32_t scale = min(((in.b[0] / 128 * frame_steps) << 12) / 100, uint32_t(1 << 20));
+            for (int i = 0; i < BENCH_INPUTS; i++) bench_span_a[i].G = fixed_clamp(((in.a[i] / 8) * scale) >> 12);
+        },
+        [&]() {
+            for (int i = 0; i < BENCH_INPUTS; i++) bench_span_a[i].G = fixed_clamp(in.a[i] / 8 * int(in.b[0] / 128) / 100 * frame_steps);
+        });
+    Serial.printf("Checks: %d failures.\n", failures);
+    return failures;
+}
+
+#endif
@@ -11,9 +11,9 @@ struct RGB {
     fixed G;
     fixed B;
 
-    RGB() : R(0), G(0), B(0) { }
+    constexpr RGB() : R(0), G(0), B(0) { }
         
-    RGB(fixed r, fixed g, fixed b)
+    constexpr RGB(fixed r, fixed g, fixed b)
         : R(r), G(g), B(b) {
     }
     
@@ -22,7 +22,7 @@ struct RGB {
     //
     // Scale the color by the specified amount.  This effectively darkens it.
 
-    RGB scale(fixed f) const {
+    constexpr RGB scale(fixed f) const {
         return RGB(fixed_mul(R, f), fixed_mul(G, f), fixed_mul(B, f));
     }
     
@@ -37,7 +37,7 @@ struct RGB {
     //
     // Linearly interpolate this color with another color.
     
-    RGB lerp(const RGB &other, fixed offset) const {
+    constexpr RGB lerp(const RGB &other, fixed offset) const {
         return RGB(
             fixed_lerp_fast(R, other.R, offset),
             fixed_lerp_fast(G, other.G, offset),
@@ -72,13 +72,15 @@ struct RGB {
     //
     // Make the input color as bright as possible while still preserving the
     // relative proportions of R,G,B.  Therefore, hue and saturation are also
-    // preserved.
+    // preserved.  This uses a Reciprocal, so each channel may be 1 more
+    // than the exact value, but the result never exceeds FIXMAX.
     
-    RGB brighten() const {
+    constexpr RGB brighten() const {
         uint16_t max = R;
         if (G > max) max = G;
         if (B > max) max = B;
-        return RGB(R * FIXMAX / max, G * FIXMAX / max, B * FIXMAX / max);
+        Reciprocal r(max);
+        return RGB(r.scale(R), r.scale(G), r.scale(B));
     }
 
     // neocolor_unsafe
@@ -97,14 +99,16 @@ struct RGB {
     //
     // Convert this color to neopixel representation.  If the input color is
     // more than 1/3 brightness, it is darkened by just exactly enough to make
-    // it 1/3 brightness.  This makes the color power-safe.
+    // it 1/3 brightness.  This makes the color power-safe.  The darkening
+    // uses a Reciprocal, so a channel may be 1 more than the exact value.
     
     uint32_t neocolor_safe() const {
         uint32_t total = uint32_t(R) + uint32_t(G) + uint32_t(B);
         if (total > FIXMAX) {
-            uint16_t r = (uint32_t(R) * (FIXMAX - 1) / total) >> 7;
-            uint16_t g = (uint32_t(G) * (FIXMAX - 1) / total) >> 7;
-            uint16_t b = (uint32_t(B) * (FIXMAX - 1) / total) >> 7;
+            Reciprocal inv(total);
+            uint16_t r = inv.divide(uint32_t(R) * (FIXMAX - 1)) >> 7;
+            uint16_t g = inv.divide(uint32_t(G) * (FIXMAX - 1)) >> 7;
+            uint16_t b = inv.divide(uint32_t(B) * (FIXMAX - 1)) >> 7;
             return (r << 16) | (g << 8) | b;
         } else {
             return neocolor_unsafe();
@@ -141,6 +145,8 @@ struct RGB {
 // tweaks really do make rainbows look nicer.
 //
 
+// The original, finer keyframe table:
+//
 // RGB hue_sat_table[] = {
 //     {32768, 0, 0},
 //         {(32768+32768+30208) / 3, (0 + 0 + 2560) / 3, 0},
@@ -175,26 +181,61 @@ struct RGB {
 //     {32768, 0, 0},
 // };
 
-RGB hue_sat_table[] = {
-    { 32768, 0, 0 },
-    { 20000, 20000, 0 },
-    { 0, 32768, 0 },
-    { 0, 20000, 20000 },
-    { 0, 0, 32768 },
-    { 20000, 0, 20000 },
-    { 32768, 0, 0 },
+// The keyframes in use are the six primaries and secondaries, with the
+// secondaries at HUE_SECONDARY_LEVEL rather than full strength.  They
+// are generated by the compiler, and stored in flash.  (tablegen.py has
+// the scripts that generated the older tables, for reference.)
+//
+
+#define HUE_SAT_ENTRIES 6
+#define HUE_SECONDARY_LEVEL 20000
+
+constexpr RGB hue_keyframe(int k) {
+    // Even keyframes are primaries, odd ones mix the neighboring primaries.
+    int primary = (k >> 1) % 3;
+    int next = (primary + 1) % 3;
+    fixed level[3] = { 0, 0, 0 };
+    if (k & 1) {
+        level[primary] = HUE_SECONDARY_LEVEL;
+        level[next] = HUE_SECONDARY_LEVEL;
+    } else {
+        level[primary] = FIXMAX;
+    }
+    return RGB(level[0], level[1], level[2]);
+}
+
+struct HueSatTable {
+    RGB entry[HUE_SAT_ENTRIES + 1];
+
+    constexpr HueSatTable() : entry() {
+        for (int k = 0; k <= HUE_SAT_ENTRIES; k++) {
+            entry[k] = hue_keyframe(k);
+        }
+    }
+
+    constexpr const RGB &operator[](int k) const { return entry[k]; }
 };
 
-const int HUE_SAT_ENTRIES = (sizeof(hue_sat_table) / sizeof(RGB)) - 1;
+constexpr HueSatTable hue_sat_table;
 
-struct RGB hue_sat(fixed hue, fixed sat) {
-    sat = fixed_clamp(sat);
+static_assert(hue_sat_table[1].R == HUE_SECONDARY_LEVEL && hue_sat_table[1].G == HUE_SECONDARY_LEVEL, "Keyframe 1 is yellow.");
+static_assert(hue_sat_table[4].B == FIXMAX, "Keyframe 4 is blue.");
+static_assert(hue_sat_table[6].R == FIXMAX, "The wheel wraps around to red.");
+
+// hue_only
+//
+// The fully saturated color for a hue.  This is hue_sat with sat = FIXMAX.
+
+constexpr RGB hue_only(fixed hue) {
     uint32_t hx = (hue & 0x7FFF) * HUE_SAT_ENTRIES;
     uint32_t sector = hx >> 15;
     uint32_t offset = hx & 32767;
-    RGB rgb1 = hue_sat_table[sector+0];
-    RGB rgb2 = hue_sat_table[sector+1];
-    RGB calculated_hue = rgb1.lerp(rgb2, offset);
+    return hue_sat_table[sector].lerp(hue_sat_table[sector + 1], offset);
+}
+
+constexpr RGB hue_sat(fixed hue, fixed sat) {
+    sat = fixed_clamp(sat);
+    RGB calculated_hue = hue_only(hue);
     uint32_t grey33 = (32768 - sat) * (FIXMAX / 3);
     uint32_t r = (calculated_hue.R * sat + grey33) >> 15;
     uint32_t g = (calculated_hue.G * sat + grey33) >> 15;
@@ -202,6 +243,86 @@ struct RGB hue_sat(fixed hue, fixed sat) {
     return RGB(r, g, b);
 }
 
+// hue_sat_bright
+//
+// hue_sat(hue, sat).brighten(), but faster when the color is fully
+// saturated.
+//
+// The fully saturated, brightened colors come from a finer wheel, with
+// HUE_BRIGHT_STEPS entries per keyframe, which the compiler computes by
+// brightening hue_only.  Between entries, the colors are interpolated;
+// the error is a couple of parts in 32768.  Partially saturated colors
+// are just computed.
+//
+
+#define HUE_BRIGHT_STEPS 64
+#define HUE_BRIGHT_ENTRIES (HUE_SAT_ENTRIES * HUE_BRIGHT_STEPS + 1)
+#define HUE_BRIGHT_SHIFT 9
+
+static_assert((FIXMAX >> HUE_BRIGHT_SHIFT) == HUE_BRIGHT_STEPS, "HUE_BRIGHT_SHIFT must match HUE_BRIGHT_STEPS.");
+
+struct HueBrightTable {
+    RGB hue[HUE_BRIGHT_ENTRIES];
+
+    constexpr HueBrightTable() : hue() {
+        for (int i = 0; i < HUE_BRIGHT_ENTRIES; i++) {
+            int sector = i / HUE_BRIGHT_STEPS;
+            int offset = (i % HUE_BRIGHT_STEPS) << HUE_BRIGHT_SHIFT;
+            RGB c = hue_sat_table[HUE_SAT_ENTRIES];
+            if (sector < HUE_SAT_ENTRIES) {
+                c = hue_sat_table[sector].lerp(hue_sat_table[sector + 1], offset);
+            }
+            hue[i] = c.brighten();
+        }
+    }
+};
+
+constexpr HueBrightTable hue_bright_table;
+
+inline RGB hue_only_bright(fixed hue) {
+    uint32_t hx = (hue & 0x7FFF) * HUE_SAT_ENTRIES;
+    uint32_t index = hx >> HUE_BRIGHT_SHIFT;
+    uint32_t offset = (hx << (15 - HUE_BRIGHT_SHIFT)) & 0x7FFF;
+    return hue_bright_table.hue[index].lerp(hue_bright_table.hue[index + 1], offset);
+}
+
+inline RGB hue_sat_bright(fixed hue, fixed sat) {
+    if (sat >= FIXMAX) return hue_only_bright(hue);
+    return hue_sat(hue, sat).brighten();
+}
+
+// hsv_span, hsv_bright_span
+//
+// Convert arrays of hue, saturation and value to RGB: dst[i] is
+// hue_sat(hue[i], sat[i]).scale(val[i]), or the same with hue_sat_bright.
+// If 'sat' is NULL, every color is fully saturated, and the saturation
+// step is skipped entirely.  Fully saturated entries skip it, too.
+
+void hsv_span(RGB *dst, const fixed *hue, const fixed *sat, const fixed *val, int n) {
+    if (sat == NULL) {
+        for (int i = 0; i < n; i++) {
+            dst[i] = hue_only(hue[i]).scale(val[i]);
+        }
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        RGB c = (sat[i] >= FIXMAX) ? hue_only(hue[i]) : hue_sat(hue[i], sat[i]);
+        dst[i] = c.scale(val[i]);
+    }
+}
+
+void hsv_bright_span(RGB *dst, const fixed *hue, const fixed *sat, const fixed *val, int n) {
+    if (sat == NULL) {
+        for (int i = 0; i < n; i++) {
+            dst[i] = hue_only_bright(hue[i]).scale(val[i]);
+        }
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        dst[i] = hue_sat_bright(hue[i], sat[i]).scale(val[i]);
+    }
+}
+
 const fixed HUE_RED = (FIXMAX * 0 / 12);
 const fixed HUE_ORANGE = (FIXMAX * 1 / 12);
 const fixed HUE_YELLOW = (FIXMAX * 2 / 12);
@@ -236,192 +357,366 @@ const fixed HUE_PINK = (FIXMAX * 11 / 12);
 // as wide as a normal stripe.  Doing this uses up N slots in the
 // rainbow's data table.
 // 
-// There is a rainbow constructor that provides a little language to
-// generate a rainbow quickly.  There is also a rainbow constructor
-// that accepts an index into a library of standard rainbows.
+// There is a little language to generate a rainbow quickly.  A spec
+// that is known when the code is written should be a rainbow literal,
+// which the compiler parses into a table in flash.  A malformed literal
+// is a compile error.  A rainbow can also be built from a literal, or
+// parsed from a string at runtime.
+//
+// Looking up a color in a rainbow takes a multiply and a lerp.  An
+// effect that looks up every LED, every frame, should bake the rainbow
+// into a RainbowPalette instead.  A palette is a fixed number of
+// precomputed colors, so a lookup is a shift and a load.  The palette
+// can have a brightness scale folded in, too.  Baking costs as much as
+// RAINBOW_PALETTE_SIZE lookups, so it should only be done when the
+// rainbow or the scale changes.
+//
+
+#define RAINBOW_MAXRANGES 64
+#define RAINBOW_PALETTE_BITS 9
+#define RAINBOW_PALETTE_SIZE (1 << RAINBOW_PALETTE_BITS)
+#define RAINBOW_PALETTE_SHIFT (15 - RAINBOW_PALETTE_BITS)
+
+struct RainbowPalette {
+    RGB color[RAINBOW_PALETTE_SIZE];
+
+    // get
+    //
+    // obtain the color at the specified offset, the same as
+    // Rainbow::get, but rounded to the palette's resolution.
+
+    RGB get(fixed h) const {
+        return color[(h & 0x7FFF) >> RAINBOW_PALETTE_SHIFT];
+    }
+};
+
+
+// rainbow_lookup, rainbow_bake, rainbow_fill
 //
+// The operations on a table of ranges, shared by Rainbow and
+// RainbowLiteral.
 
-#define RAINBOW_MAXRANGES 256
+constexpr RGB rainbow_lookup(const RGB *lo, const RGB *hi, uint32_t nranges, fixed h) {
+    uint32_t hx = (h & 0x7FFF) * nranges;
+    uint32_t sector = hx >> 15;
+    uint32_t offset = hx & 32767;
+    return lo[sector].lerp(hi[sector], offset);
+}
 
+void rainbow_bake(const RGB *lo, const RGB *hi, uint32_t nranges, RainbowPalette &palette, fixed scale) {
+    const uint32_t half = 1 << (RAINBOW_PALETTE_SHIFT - 1);
+    for (uint32_t i = 0; i < RAINBOW_PALETTE_SIZE; i++) {
+        RGB c = rainbow_lookup(lo, hi, nranges, (i << RAINBOW_PALETTE_SHIFT) + half);
+        palette.color[i] = (scale >= FIXMAX) ? c : c.scale(scale);
+    }
+}
+
+constexpr void rainbow_fill(RGB *lo, RGB *hi, int expand, const RGB &rgb1, const RGB &rgb2) {
+    for (int i = 0; i < expand; i++) {
+        fixed offset1 = (FIXMAX * (i + 0)) / expand;
+        fixed offset2 = (FIXMAX * (i + 1)) / expand;
+        lo[i] = rgb1.lerp(rgb2, offset1);
+        hi[i] = rgb1.lerp(rgb2, offset2);
+    }
+}
+
+// rainbow_parse
+//
+// parse a little language to initialize a rainbow.  The language
+// consists of pairs of colors, where each color is represented by
+// a single letter, like this:
+//
+//  "R O, O Y, Y G, G B"
+//
+// The colors understood are: R-Red, G-Green, B-Blue, C-Cyan,
+// Y-Yellow, M-Magenta, P-Pink, O-Orange, I-Indigo, W-White,
+// H-Half-Grey, Q-Quarter-Grey, Z-Black.   The string above therefore
+// represents a four-stripe rainbow that goes red->orange,
+// orange->yellow, yellow->green, green->blue.
+//
+// Be careful, there are some intuitively obvious colors that
+// are wrong - B isn't black, G isn't grey.
+//
+// Prefix modifiers can be specified before specifying a color.
+// These are:
+//
+//    "D" (dark): value = value * 7/8.
+//    "d" (very dark): value = value * 1/2.
+//    "L" (light): saturation = saturation * 7/8.
+//    "l" (very light): saturation = saturation * 1/2.
+//    "1", "2", "3"...: Set the expand level.
+//
+// So for example, "purple" isn't one of the established colors.
+// But we can put the "D" modifier in front of "P" (pink) to
+// turn it into purple.  The following is a rainbow that
+// transitions from Blue->Purple->Red:
+//
+//  "B DP, DP R"
+//
+// You can use multiple modifiers, or repeat modifiers - for
+// example, "DDP" is a darker purple.  Commas can optionally
+// be placed between pairs.  Whitespace is allowed but ignored.
+//
+// Each pair is handed to sink.add_range.  If the spec is malformed,
+// the parser calls sink.fail with the reason, and stops.  The parser
+// is constexpr, so that the compiler can run it on rainbow literals.
+
+enum RainbowParseError {
+    RAINBOW_INVALID_CHARACTER,
+    RAINBOW_INCOMPLETE_RULE,
+    RAINBOW_TOO_MANY_RANGES,
+    RAINBOW_EMPTY,
+};
+
+template <typename Sink>
+constexpr bool rainbow_parse(const char *config, Sink &sink) {
+    RGB color[2] = { RGB(), RGB() };
+    int ncolors = 0;
+    int nranges = 0;
+    fixed hue = 65535;
+    fixed saturation = FIXMAX;
+    fixed value = FIXMAX;
+    int expand = 1;
+    for (;; config++) {
+        char ch = *config;
+        bool end_of_rule = false;
+        switch (ch) {
+        case 0  :
+        case ',': end_of_rule = true; break;
+        case ' ': break;
+        case 'D': value = muldiv(value, 7, 8); break;
+        case 'd': value = muldiv(value, 1, 2); break;
+        case 'L': saturation = muldiv(saturation, 7, 8); break;
+        case 'l': saturation = muldiv(saturation, 1, 2); break;
+        case 'R': hue = HUE_RED; break;
+        case 'G': hue = HUE_GREEN; break;
+        case 'B': hue = HUE_BLUE; break;
+        case 'C': hue = HUE_CYAN; break;
+        case 'Y': hue = HUE_YELLOW; break;
+        case 'M': hue = HUE_MAGENTA; break;
+        case 'O': hue = HUE_ORANGE; break;
+        case 'P': hue = HUE_PINK; break;
+        case 'I': hue = HUE_MAGENTA; value = muldiv(value, 5, 6); break;
+        case 'W': hue = 0; saturation = 0; break;
+        case 'H': hue = 0; saturation = 0; value = muldiv(value, 7, 8); break;
+        case 'Q': hue = 0; saturation = 0; value = muldiv(value, 1, 2); break;
+        case 'Z': hue = 0; value = 0; break;
+        default:
+            if ((ch < '1') || (ch > '9')) {
+                sink.fail(RAINBOW_INVALID_CHARACTER);
+                return false;
+            }
+            expand = ch - '0';
+        }
+        if (hue != 65535) {
+            color[ncolors++] = hue_sat(hue, saturation).scale(value);
+            if (ncolors == 2) {
+                nranges += expand;
+                if (nranges > RAINBOW_MAXRANGES) {
+                    sink.fail(RAINBOW_TOO_MANY_RANGES);
+                    return false;
+                }
+                sink.add_range(expand, color[0], color[1]);
+                ncolors = 0;
+                expand = 1;
+            }
+            hue = 65535;
+            saturation = FIXMAX;
+            value = FIXMAX;
+        }
+        if (end_of_rule) {
+            if ((ncolors != 0) || (expand != 1) || (saturation != FIXMAX) || (value != FIXMAX)) {
+                sink.fail(RAINBOW_INCOMPLETE_RULE);
+                return false;
+            }
+        }
+        if (ch == 0) break;
+    }
+    if (nranges == 0) {
+        sink.fail(RAINBOW_EMPTY);
+        return false;
+    }
+    return true;
+}
+
+// Rainbow literals
+//
+// A rainbow literal is parsed by the compiler:
+//
+//   constexpr auto rainbow_france = RAINBOW_LITERAL("R R, W W, B B");
+//
+// The result is a RainbowLiteral holding exactly as many ranges as
+// the spec needs.  Declared constexpr, it lives in flash.
+//
+// The error functions are deliberately not constexpr.  If the spec is
+// malformed, the compiler reaches one of them while parsing, and the
+// error message names it.
+
+void rainbow_literal_has_invalid_character() {}
+void rainbow_literal_has_incomplete_rule() {}
+void rainbow_literal_has_too_many_ranges() {}
+void rainbow_literal_is_empty() {}
+
+constexpr void rainbow_literal_fail(RainbowParseError error) {
+    switch (error) {
+    case RAINBOW_INVALID_CHARACTER: rainbow_literal_has_invalid_character(); break;
+    case RAINBOW_INCOMPLETE_RULE: rainbow_literal_has_incomplete_rule(); break;
+    case RAINBOW_TOO_MANY_RANGES: rainbow_literal_has_too_many_ranges(); break;
+    case RAINBOW_EMPTY: rainbow_literal_is_empty(); break;
+    }
+}
+
+struct RainbowLiteralCounter {
+    int nranges;
+
+    constexpr RainbowLiteralCounter() : nranges(0) { }
+    constexpr void add_range(int expand, const RGB &, const RGB &) { nranges += expand; }
+    constexpr void fail(RainbowParseError error) { rainbow_literal_fail(error); }
+};
+
+constexpr int rainbow_literal_size(const char *spec) {
+    RainbowLiteralCounter counter;
+    rainbow_parse(spec, counter);
+    return counter.nranges;
+}
+
+template <int N>
+struct RainbowLiteral {
+    RGB lo[N];
+    RGB hi[N];
+    int nranges;
+
+    constexpr RainbowLiteral(const char *spec) : lo(), hi(), nranges(0) {
+        rainbow_parse(spec, *this);
+    }
+
+    constexpr void add_range(int expand, const RGB &rgb1, const RGB &rgb2) {
+        rainbow_fill(lo + nranges, hi + nranges, expand, rgb1, rgb2);
+        nranges += expand;
+    }
+
+    constexpr void fail(RainbowParseError error) { rainbow_literal_fail(error); }
+
+    constexpr RGB get(fixed h) const {
+        return rainbow_lookup(lo, hi, N, h);
+    }
+
+    void bake(RainbowPalette &palette, fixed scale = FIXMAX) const {
+        rainbow_bake(lo, hi, N, palette, scale);
+    }
+};
+
+#define RAINBOW_LITERAL(spec) RainbowLiteral<rainbow_literal_size(spec)>(spec)
+
+// Standard rainbows.
+
+constexpr auto rainbow_standard = RAINBOW_LITERAL("R Y, Y G, G C, C B, B M, M R");
+
+static_assert(rainbow_standard.nranges == 6, "The standard rainbow has six ranges.");
+static_assert(rainbow_standard.get(0).R == FIXMAX, "The standard rainbow starts at red.");
 
 class Rainbow {
 private:
     RGB range_lo_[RAINBOW_MAXRANGES];
     RGB range_hi_[RAINBOW_MAXRANGES];
     uint32_t nranges_;
-        
+
 public:
     // clear
     //
     // Remove all stripes from the rainbow.
-    
+
     void clear() {
         nranges_ = 0;
     }
-    
+
     // add_range
     //
     // Add a stripe to the rainbow.
-    
+
     void add_range(int expand, const RGB &rgb1, const RGB &rgb2) {
-        for (int i = 0; i < expand; i++) {
-            if (nranges_ == RAINBOW_MAXRANGES) {
-                Serial.printf("Palette overflow.\n");
-                return;
-            }
-            fixed offset1 = (FIXMAX * (i + 0)) / expand;
-            fixed offset2 = (FIXMAX * (i + 1)) / expand;
-            range_lo_[nranges_] = rgb1.lerp(rgb2, offset1);
-            range_hi_[nranges_] = rgb1.lerp(rgb2, offset2);
-            nranges_++;
+        if (nranges_ + expand > RAINBOW_MAXRANGES) {
+            Serial.printf("Palette overflow.\n");
+            expand = RAINBOW_MAXRANGES - nranges_;
         }
+        rainbow_fill(range_lo_ + nranges_, range_hi_ + nranges_, expand, rgb1, rgb2);
+        nranges_ += expand;
     }
-    
-        
+
     // apply_scale
     //
     // darken all the colors in the rainbow.
-    
+
     void apply_scale(fixed n) {
         for (int i = 0; i < nranges_; i++) {
             range_lo_[i] = range_lo_[i].scale(n);
             range_hi_[i] = range_hi_[i].scale(n);
         }
     }
-    
+
     // get
     //
     // obtain the color at the specified offset, where h=0
     // represents the leftmost edge of the rainbow, and h=32768
     // represents the rightmost edge.
-    
-    RGB get(fixed h) {
-        uint32_t hx = (h & 0x7FFF) * nranges_;
-        uint32_t sector = hx >> 15;
-        uint32_t offset = hx & 32767;
-        RGB rgb1 = range_lo_[sector];
-        RGB rgb2 = range_hi_[sector];
-        return rgb1.lerp(rgb2, offset);
+
+    RGB get(fixed h) const {
+        return rainbow_lookup(range_lo_, range_hi_, nranges_, h);
     }
-    
-    // parse
-    //
-    // parse a little language to initialize a rainbow.  The language
-    // consists of pairs of colors, where each color is represented by
-    // a single letter, like this:
-    //
-    //  "R O, O Y, Y G, G B"
-    //
-    // The colors understood are: R-Red, G-Green, B-Blue, C-Cyan,
-    // Y-Yellow, M-Magenta, P-Pink, O-Orange, I-Indigo, W-White,
-    // H-Half-Grey, Q-Quarter-Grey, Z-Black.   The string above therefore
-    // represents a four-stripe rainbow that goes red->orange,
-    // orange->yellow, yellow->green, green->blue.
-    //
-    // Be careful, there are some intuitively obvious colors that
-    // are wrong - B isn't black, G isn't grey.
-    //
-    // Be careful, all of them are intuitive except black. 
-    //
-    // Prefix modifiers can be specified before specifying a color.
-    // These are:
-    //
-    //    "D" (dark): value = value * 7/8.
-    //    "d" (very dark): value = value * 1/2.
-    //    "L" (light): saturation = saturation * 7/8.
-    //    "l" (very light): saturation = saturation * 1/2.
-    //    "1", "2", "3"...: Set the expand level.
-    //
-    // So for example, "purple" isn't one of the established colors.
-    // But we can put the "D" modifier in front of "P" (pink) to
-    // turn it into purple.  The following is a rainbow that
-    // transitions from Blue->Purple->Red:
+
+    // bake
     //
-    //  "B DP, DP R"
+    // fill a palette with the colors of this rainbow, darkened by the
+    // specified scale.  Each palette entry is the color at the center
+    // of the slice of the rainbow that it covers.
+
+    void bake(RainbowPalette &palette, fixed scale = FIXMAX) const {
+        rainbow_bake(range_lo_, range_hi_, nranges_, palette, scale);
+    }
+
+    // parse
     //
-    // You can use multiple modifiers, or repeat modifiers - for
-    // example, "DDP" is a darker purple.  Commas can optionally
-    // be placed between pairs.  Whitespace is allowed but ignored.
-    
-    void parse(const char * config) {
-        RGB color[2];
-        int ncolors = 0;
-        fixed hue = 65535;
-        fixed saturation = FIXMAX;
-        fixed value = FIXMAX;
-        int expand = 1;
-        bool check_blank = false;
+    // parse a rainbow spec at runtime, using rainbow_parse.  This is
+    // silent, so it's safe to use on any input.  If the spec is
+    // malformed, it returns false, and the rainbow is solid black.
+
+    void fail(RainbowParseError) { }
+
+    bool parse(const char *config) {
         clear();
-        while (true) {
-            Serial.printf("Parsing %c (%d)\n", *config, *config);
-            switch (*config) {
-            case 0  : check_blank = true;
-            case ',': check_blank = true;
-            case ' ': break;
-            case '1': expand = 1; break;
-            case '2': expand = 2; break;
-            case '3': expand = 3; break;
-            case '4': expand = 4; break;
-            case '5': expand = 5; break;
-            case '6': expand = 6; break;
-            case '7': expand = 7; break;
-            case '8': expand = 8; break;
-            case '9': expand = 9; break;
-            case 'D': value = muldiv(value, 7, 8); break;
-            case 'd': value = muldiv(value, 1, 2); break;
-            case 'L': saturation = muldiv(saturation, 7, 8); break;
-            case 'l': saturation = muldiv(saturation, 1, 2); break;
-            case 'R': hue = HUE_RED; break;
-            case 'G': hue = HUE_GREEN; break;
-            case 'B': hue = HUE_BLUE; break;
-            case 'C': hue = HUE_CYAN; break;
-            case 'Y': hue = HUE_YELLOW; break;
-            case 'M': hue = HUE_MAGENTA; break;
-            case 'O': hue = HUE_ORANGE; break;
-            case 'P': hue = HUE_PINK; break;
-            case 'I': hue = HUE_MAGENTA; value = muldiv(value, 5, 6); break;
-            case 'W': hue = 0; saturation = 0; break;
-            case 'H': hue = 0; saturation = 0; value = muldiv(value, 7, 8); break;
-            case 'Q': hue = 0; saturation = 0; value = muldiv(value, 1, 2); break;
-            case 'Z': hue = 0; value = 0; break;
-            default:
-                Serial.printf("Invalid character in rainbow spec.\n");
-            }
-            if (hue != 65535) {
-                RGB c = hue_sat(hue, saturation).scale(value);
-                color[ncolors++] = c;
-                Serial.printf("Stored RGB %d, %d, %d\n", c.R, c.G, c.B);
-                if (ncolors == 2) {
-                    add_range(expand, color[0], color[1]);
-                    Serial.printf("Added range %d,%d,%d - %d,%d,%d\n",
-                        color[0].R, color[0].G, color[0].B,
-                        color[1].R, color[1].G, color[1].B);
-                    ncolors = 0;
-                    expand = 1;
-                }
-                hue = 65535;
-                saturation = FIXMAX;
-                value = FIXMAX;
-            }
-            if (check_blank) {
-                if ((ncolors != 0) || (expand != 1) || (saturation != FIXMAX) || (value != FIXMAX) || (hue != 65535)) {
-                    Serial.printf("Comma not at end of rule.\n");
-                }
-            }
-            if (*config == 0) break;
-            config++;
+        if (rainbow_parse(config, *this)) return true;
+        clear();
+        add_range(1, RGB(), RGB());
+        return false;
+    }
+
+    // load
+    //
+    // copy the ranges of a rainbow literal.
+
+    template <int N>
+    void load(const RainbowLiteral<N> &literal) {
+        for (int i = 0; i < N; i++) {
+            range_lo_[i] = literal.lo[i];
+            range_hi_[i] = literal.hi[i];
         }
+        nranges_ = N;
     }
 
     // constructor
     //
     // This constructor uses the parse routine (above) to build
     // a rainbow from a string.
-    
+
     Rainbow(const char *config) {
         parse(config);
     }
-    
+
+    template <int N>
+    Rainbow(const RainbowLiteral<N> &literal) {
+        load(literal);
+    }
+
     Rainbow() {
         clear();
     }
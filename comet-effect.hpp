@@ -1,76 +1,84 @@
 #define MAXCOMETS 300
 
-struct Comet {
-    fixed edge;
-    bool backward;
-    fixed countdown; // Time until this starts running.
-    fixed travel; // A number from 0 to FIXMAX.
-    fixed speed; // If speed is zero, this comet is off.
-    fixed size; // In LEDS
-    fixed hue;
-};
+// Comet positions along an edge, in fpixels.  A comet is shorter than
+// an edge, so it starts no further back than one edge length.
+typedef FPixels<LEDS_PER_EDGE * 64> CometFPixels;
+
+// The brightness along a comet, from its tail to its head.
+constexpr CurveTable<2> comet_hotness(CurveKnots(0, FIXMAX*1/3, FIXMAX*2/3, FIXMAX*3/3, 0));
+
+// Comets are particles.  The position is the travel along the edge, a
+// number from 0 to FIXMAX, and the speed is the travel per frame.  A
+// comet waits a random delay before it starts, and dies when it runs
+// off the end of its edge.
 
 struct CometEffect {
-    Comet comets_[MAXCOMETS];
+    Particles<MAXCOMETS> comets_;
+    uint8_t size_[MAXCOMETS]; // In LEDs
+    fixed hue_[MAXCOMETS];
     fixed decay_[TOTAL_LEDS];
     RGB color_[TOTAL_LEDS];
-    int active_comets_;
     // These parameters persist for an entire show.
     int hue_base_;
     int hue_range_;
     int decay_multiplier_;
     int speed_multiplier_;
     int peak_comets_;
+    Prng rng_;
+
+    static const char *name() { return "CometEffect"; }
     
     void initialize_show() {
-        hue_base_ = random(FIXMAX);
-        hue_range_ = 2000 + random(10000);
-        decay_multiplier_ = pick_one(20, 40, 80, 90, 100, 100, 100, 100, 110, 150);
-        speed_multiplier_ = pick_one(40, 60, 80, 100, 100, 100, 100, 120, 150, 200);
-        peak_comets_ = pick_one(30, 30, 40, 40, 50, 50, 60, 60, 150, 300);
+        hue_base_ = rng_.below(FIXMAX);
+        hue_range_ = 2000 + rng_.below(10000);
+        decay_multiplier_ = rng_.pick_one(20, 40, 80, 90, 100, 100, 100, 100, 110, 150);
+        speed_multiplier_ = rng_.pick_one(40, 60, 80, 100, 100, 100, 100, 120, 150, 200);
+        peak_comets_ = rng_.pick_one(30, 30, 40, 40, 50, 50, 60, 60, 150, 300);
 
+        rng_.fill_below(decay_, TOTAL_LEDS, 300);
         for (int i = 0; i < TOTAL_LEDS; i++) {
             color_[i] = RGB(0,0,0);
-            decay_[i] = 150 + random(300);
-            switch(random(3)) {
+            decay_[i] += 150;
+            switch(rng_.below(3)) {
                 case 0: break;
                 case 1: decay_[i] *= 3; break;
                 case 2: decay_[i] *= 9; break;
             }
         }
-        active_comets_ = 0;
-        for (int i = 0; i < MAXCOMETS; i++) {
-            comets_[i].speed = 0;
-        }
+        comets_.clear();
     }
     
     CometEffect() {
+        rng_ = prng_new_stream();
         initialize_show();
     }
         
     void kill_finished_comets() {
-        for (int i = 0; i < MAXCOMETS; i++) {
-            Comet &comet = comets_[i];
-            if ((comet.speed > 0) && (comet.travel > FIXMAX)) {
-                comet.speed = 0;
-                active_comets_--;
+        for (int i = 0; i < comets_.live();) {
+            if (comets_.position[comets_.slot(i)] > FIXMAX) {
+                comets_.kill(i);
+            } else {
+                i++;
             }
         }
     }
 
     void start_new_comets(int desired_comets, int move_speed) {
-        for (int i = 0; i < MAXCOMETS; i++) {
-            Comet &comet = comets_[i];
-            if ((comet.speed == 0) && (active_comets_ < desired_comets)) {
-                comet.edge = random(TOTAL_EDGES);
-                comet.backward = (random(2) == 0);
-                comet.travel = 0;
-                comet.speed = move_speed + random(move_speed * 3);
-                comet.size = 5 + random(5);
-                comet.hue = (hue_base_ + random(hue_range_)) & 0x7FFF;
-                comet.countdown = random(1000);
-                active_comets_++;
-            }
+        while ((comets_.size() < desired_comets) && !comets_.full()) {
+            int edge = rng_.below(TOTAL_EDGES);
+            bool backward = rng_.coin();
+            fixed speed = move_speed + rng_.below(move_speed * 3);
+            int size = 5 + rng_.below(5);
+            fixed hue = (hue_base_ + rng_.below(hue_range_)) & 0x7FFF;
+            uint32_t delay = rng_.below(1000);
+            // A comet that can't move would never finish.
+            if (speed == 0) break;
+            int c = comets_.spawn(delay);
+            comets_.edge[c] = DirectedEdge(edge, backward).pack();
+            comets_.position[c] = 0;
+            comets_.speed[c] = speed;
+            size_[c] = size;
+            hue_[c] = hue;
         }
     }
         
@@ -85,51 +93,52 @@ struct CometEffect {
         
         start_new_comets(desired_comets, move_speed);
         
+        // The decay is decay_[i] * decay_speed * frame_steps / 100.  The
+        // divide is folded into a per-frame multiplier with 12 fraction
+        // bits, which is within 2 of the exact value.  The multiplier is
+        // capped where even the smallest decay_ saturates, so the product
+        // fits in 32 bits.
+        uint32_t decay_scale = min(((decay_speed * frame_steps) << 12) / 100, uint32_t(1 << 20));
         for (int i = 0; i < TOTAL_LEDS; i++) {
-            const int fixdecay = 10;
-            int decay = decay_[i] * decay_speed / 100;
-            color_[i] = color_[i].scale(FIXMAX - decay).sub(RGB(fixdecay, fixdecay, fixdecay));
+            int decay = fixed_clamp((decay_[i] * decay_scale) >> 12);
+            color_[i] = color_[i].scale(FIXMAX - decay);
         }
+        rgb_sub_grey_span(color_, 10 * frame_steps, TOTAL_LEDS);
         
-        for (int comet_index = 0; comet_index < MAXCOMETS; comet_index++) {
-            Comet &comet = comets_[comet_index];
-            if (comet.speed == 0) continue;
-            if (comet.countdown > 0) {
-                comet.countdown--;
-                continue;
-            }
-            RGB color = hue_sat(comet.hue, FIXMAX);
+        comets_.release();
+        for (int comet_index = 0; comet_index < comets_.live(); comet_index++) {
+            int c = comets_.slot(comet_index);
+            DirectedEdge edge = comets_.directed_edge(c);
+            RGB color = hue_sat(hue_[c], FIXMAX);
             // Comet path constants
-            const int comet_length_fpixels = pixels_to_fpixels(comet.size);
-            const int travel_start_fpixels = -comet_length_fpixels;
-            const int travel_end_fpixels = pixels_to_fpixels(LEDS_PER_EDGE);
-            // These positions are specified in fpixels ("fractional pixels")
-            fpixels comet_fpixels_lo = fixed_lerp(travel_start_fpixels, travel_end_fpixels, comet.travel);
-            fpixels comet_fpixels_hi = comet_fpixels_lo + comet_length_fpixels;
+            const CometFPixels comet_length_fpixels(pixels_to_fpixels(size_[c]));
+            const CometFPixels travel_start_fpixels(-comet_length_fpixels);
+            const CometFPixels travel_end_fpixels(pixels_to_fpixels(LEDS_PER_EDGE));
+            // These positions are specified in fpixels ("fractional pixels").
+            // Their ranges are known, so the lerp takes the fast path.
+            CometFPixels comet_fpixels_lo = fixed_lerp(travel_start_fpixels, travel_end_fpixels, fixed(comets_.position[c]));
+            auto comet_fpixels_hi = comet_fpixels_lo + comet_length_fpixels;
             int comet_pixels_lo = clamp(0, LEDS_PER_EDGE-1, fpixels_round_up(comet_fpixels_lo));
             int comet_pixels_hi = clamp(0, LEDS_PER_EDGE-1, fpixels_round_down(comet_fpixels_hi));
+            UnlerpStepper offsets(comet_fpixels_lo, comet_fpixels_hi, pixels_to_fpixels(comet_pixels_lo), pixels_to_fpixels(1));
             for (int i = comet_pixels_lo; i <= comet_pixels_hi; i++) {
-                fixed offset = fixed_unlerp(comet_fpixels_lo, comet_fpixels_hi, pixels_to_fpixels(i));
-                int hotness = spline4(offset, 0, FIXMAX*1/3, FIXMAX*2/3, FIXMAX*3/3, 0);
-                int index;
-                if (comet.backward) {
-                    index = edge_backward(comet.edge, i);
-                } else {
-                    index = edge_forward(comet.edge, i);
-                }
+                fixed offset = offsets.next();
+                int hotness = comet_hotness(offset);
+                int index = edge.offset(i);
                 color_[index] = color_[index].maxv(color.scale(hotness));
             }
-            // Advance the comet.
-            comet.travel += comet.speed;
         }
+        comets_.advance(frame_steps);
         kill_finished_comets();
+        comets_.tick(frame_steps);
 
+        PROFILE_ENTER(PROFILE_CONVERT);
         RGB white(FIXMAX, FIXMAX, FIXMAX);
         for (int i = 0; i < TOTAL_LEDS; i++) {
             int total = int(color_[i].R) + int(color_[i].G) + int(color_[i].B);
             total = fixed_clamp(total - 4000);
             RGB color = color_[i].lerp(white, total);
-            leds.setPixelColor(i, color.neocolor_unsafe());
+            led_write(i, color);
         }
         
         return age < FIXMAX;
@@ -0,0 +1,57 @@
+// Curve Tables
+//
+// Effects shape their pixels with curves of a single fixed input: the
+// brightness profile along a comet's tail, the waves of a burst.
+// Evaluating a spline for every pixel repeats the same work every
+// frame, so a curve can be declared once as a table.
+//
+// A CurveTable<Bits> is computed by the compiler, which evaluates the
+// curve at 2^Bits + 1 evenly spaced inputs from 0 to FIXMAX, and stores
+// the results in flash.  A lookup interpolates between the two nearest
+// entries, and inputs at or above FIXMAX give the last entry.
+//
+// The curve can be any constexpr function or function object that maps
+// a fixed to a fixed.  CurveKnots is a function object for a spline,
+// which behaves exactly like spline2 through spline8 with the same
+// knots.  If a spline has 2^Bits segments, its table holds exactly the
+// knots, and lookups match the spline exactly.  Smooth curves need more
+// entries: the error shrinks by 4 with every extra bit.  check_curves in
+// bench.hpp reports the error of every table in the sketch.
+//
+
+struct CurveKnots {
+    fixed knot[9];
+    int segments;
+
+    template <typename... T>
+    constexpr CurveKnots(T... knots) : knot{ fixed(knots)... }, segments(sizeof...(T) - 1) {
+        static_assert((sizeof...(T) >= 2) && (sizeof...(T) <= 9), "A spline has 2 to 9 knots.");
+    }
+
+    constexpr fixed operator()(fixed i) const {
+        uint32_t ix = i * segments;
+        uint32_t segment = ix >> 15;
+        uint32_t offset = ix & 0x7FFF;
+        if (segment >= segments) return knot[segments];
+        return fixed_lerp_fast(knot[segment], knot[segment + 1], offset);
+    }
+};
+
+template <int Bits>
+struct CurveTable {
+    fixed entry[(1 << Bits) + 1];
+
+    template <typename Curve>
+    constexpr CurveTable(const Curve &curve) : entry() {
+        for (int i = 0; i <= (1 << Bits); i++) {
+            entry[i] = curve(fixed(i << (15 - Bits)));
+        }
+    }
+
+    fixed operator()(fixed i) const {
+        if (i >= FIXMAX) return entry[1 << Bits];
+        uint32_t index = i >> (15 - Bits);
+        uint32_t offset = (i << Bits) & 0x7FFF;
+        return fixed_lerp_fast(entry[index], entry[index + 1], offset);
+    }
+};
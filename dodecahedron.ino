@@ -5,35 +5,108 @@
 // the fuses, we have to restrict power consumption in software.  To have a little
 // safety margin, this code limits power consumption to 1/3 of the theoretical maximum.
 //
-// Each individual effect must be designed to limit power consumption to 1/3!  One way
-// to accomplish this is to turn on fewer than 1/3 of the LEDs.  The other is to limit
+// The output stage in led-buffer.hpp enforces the limit on each strand, so an
+// effect can't blow a fuse.  But when a strand goes over, the whole strand is
+// dimmed, so effects should still be designed to stay near 1/3.  One way to
+// accomplish this is to turn on fewer than 1/3 of the LEDs.  The other is to limit
 // the brightness of each individual LED to 1/3.  We provide libraries to make either
-// approach easy.
+// approach easy.  Sparse effects may use brighter LEDs.
 //
 
+// Uncomment to run the microbenchmarks in bench.hpp at startup.
+//
+// #define BENCHMARK
+
+// Uncomment to replay the shows from a given random seed, instead of
+// seeding from analog noise.  The seed is printed at startup.
+//
+// #define RANDOM_SEED 12345
+
 #include <Adafruit_NeoPXL8.h>
 #include <Bounce2.h>
 
 #include "basic-math.hpp"
+#include "curves.hpp"
 #include "colors.hpp"
+#include "pixel-kernels.hpp"
 #include "pool-alloc.hpp"
+#include "effect-registry.hpp"
+#include "profiler.hpp"
+#include "frame-clock.hpp"
+#include "gamma.hpp"
 #include "led-buffer.hpp"
 #include "vector.hpp"
 #include "geometry.hpp"
+#include "projection.hpp"
+#include "spatial.hpp"
+#include "geodesic.hpp"
+#include "symmetry.hpp"
 #include "random-seeding.hpp"
+#include "prng.hpp"
+#include "particles.hpp"
 
 // Show management.
 //
-PoolAlloc pool;
+// The show_age is the number of frame periods since the show started,
+// as measured by the frame clock.  The frame_steps is the number of
+// frame periods that elapsed during the last frame.  It is normally 1,
+// but it is larger when the effect can't keep up with the frame rate.
+//
+// Two shows can be live at once.  When a show ends, the next show
+// starts, but the old show keeps running for TRANSITION_TICKS, and the
+// two are cross-faded.  Each live show has its own pool.
+//
+#define TRANSITION_TICKS (FRAME_RATE * 2)
+
+struct LiveShow {
+    void *effect;
+    uint32_t counter;
+    uint32_t start_tick;
+};
+
+PoolAlloc pool[2];
+LiveShow live_show[2];
+FrameClock frame_clock;
 uint32_t show_age = 0;
-uint32_t show_counter = 0;
-void *show_effect = NULL;
+uint32_t frame_steps = 1;
+int current_show = 0;
+bool transitioning = false;
+uint32_t transition_start = 0;
+uint32_t transition_frames = 0;
+uint32_t transition_blend_micros = 0;
+RGB transition_frame[TOTAL_LEDS];
 uint32_t clicks = 0;
 
 #include "nexus-effect.hpp"
 #include "comet-effect.hpp"
 #include "rug-effect.hpp"
 #include "half-baked-effects.hpp"
+#include "bench.hpp"
+
+// The list of shows, in the order they run.  To add a show, add its
+// effect type to this list.
+//
+typedef EffectList<
+    ZippyCarEffect,
+    NexusEffect,
+    WaterFallEffect,
+    CometEffect,
+    RugEffect
+> ShowList;
+
+// Effects that work, but aren't in the rotation.  Listing them here
+// checks that they still fit in the pool.
+//
+typedef EffectList<
+    BurstEffect,
+    BoundariesEffect,
+    LittleCarEffect
+> ParkedEffects;
+
+static_assert(ParkedEffects::max_size <= POOL_ALLOC_SIZE, "Parked effect is too big for the pool.");
+#if PROFILE
+static_assert(ShowList::count <= PROFILE_MAX_EFFECTS, "Too many shows for the profiler.");
+#endif
 
 // The pushbutton is connected to pin 4.  We use the debouncing library
 // to read the pushbutton.
@@ -47,66 +120,68 @@ Bounce debouncer = Bounce();
 void setup() {
     Serial.begin(9600);
     delay(5000);
-    populate_successor_edges();
-    leds.begin();
-    leds.setBrightness(255);
+    led_begin();
     debouncer.attach(BUTTON_PIN, INPUT_PULLUP); // Attach the debouncer to a pin with INPUT_PULLUP mode
     debouncer.interval(25); // Use a debounce interval of 25 milliseconds
-    randomSeed(seed_from_analog_noise(A0, A1, A5));
-    Serial.printf("Starting up.\n");
+    uint32_t seed = seed_from_analog_noise(A0, A1, A5);
+#ifdef RANDOM_SEED
+    seed = RANDOM_SEED;
+#endif
+    randomSeed(seed);
+    prng_seed(seed);
+    Serial.printf("Starting up.  Random seed is %u.\n", (unsigned)seed);
+    ShowList::report();
+#ifdef BENCHMARK
+    run_benchmarks();
+#endif
+    frame_clock.begin();
+    PROFILE_BEGIN();
 }
 
-bool update_show() {
-    switch(show_counter) {
-    case 0:
-        if (show_effect == NULL) {
-            show_effect = new(pool) ZippyCarEffect();
-        }
-        return ((ZippyCarEffect *)show_effect)->update();
-    case 1:
-        if (show_effect == NULL) {
-            show_effect = new(pool) NexusEffect();
-        }
-        return ((NexusEffect *)show_effect)->update();
-    case 2:
-        if (show_effect == NULL) {
-            show_effect = new(pool) WaterFallEffect();
-        }
-        return ((WaterFallEffect *)show_effect)->update();
-
-    case 3:
-        if (show_effect == NULL) {
-            show_effect = new(pool) CometEffect();
-        }
-        return ((CometEffect*)show_effect)->update();
-    case 4:
-        if (show_effect == NULL) {
-            show_effect = new(pool) RugEffect();
-        }
-        return ((RugEffect *)show_effect)->update();
-    default:
-        return false;
+// update_show
+//
+// Render one frame of a live show.  Returns false when the show is over.
+
+bool update_show(int slot) {
+    LiveShow &show = live_show[slot];
+    PROFILE_ENTER(PROFILE_RENDER);
+    show_age = frame_clock.ticks() - show.start_tick;
+    if (show.effect == NULL) {
+        show.effect = ShowList::create(show.counter, pool[slot]);
     }
+    return ShowList::update(show.counter, show.effect);
 }
 
-//     if (effect == NULL) {
-//          effect = new(pool) BurstEffect(20000, 9000);
-//     }
-//     ((BurstEffect *)effect)->update();
+void start_show(int slot, uint32_t counter) {
+    LiveShow &show = live_show[slot];
+    pool[slot].clear();
+    show.effect = NULL;
+    show.counter = counter;
+    show.start_tick = frame_clock.ticks();
+    frame_clock.restart_show();
+    led_swap_stats.reset();
+    led_power_reset();
+}
+
+void end_transition() {
+    int outgoing = current_show ^ 1;
+    pool[outgoing].clear();
+    live_show[outgoing].effect = NULL;
+    transitioning = false;
+    if (transition_frames > 0) {
+        Serial.printf("Transition: %d frames, %d us per frame blending.\n",
+            int(transition_frames), int(transition_blend_micros / transition_frames));
+    }
+}
 
 //     if (effect == NULL) {
-//         Rainbow *rainbow = new(pool) Rainbow(Rainbow::BOW_STANDARD_RAINBOW);
+//         Rainbow *rainbow = new(pool) Rainbow(rainbow_standard);
 //         effect = new(pool) RugOneEffect(rainbow);
 //     }
 //     ((RugOneEffect *)effect)->update();
 
 //     if (effect == NULL) {
-//         effect = new(pool) BoundariesEffect();
-//     }
-//     ((BoundariesEffect *)effect)->update();
-
-//     if (effect == NULL) {
-//         Rainbow *rainbow = new(pool) Rainbow(Rainbow::BOW_STANDARD_RAINBOW);
+//         Rainbow *rainbow = new(pool) Rainbow(rainbow_standard);
 //         effect = new(pool) WaterFallEffect(rainbow);
 //     }
 //     ((WaterFallEffect*)effect)->update();
@@ -117,7 +192,7 @@ bool update_show() {
 //     ((BrightnessEffect*)effect)->update();
 
 //     if (effect == NULL) {
-//         Rainbow *rainbow = new(pool) Rainbow("R Y, Y G, G C, C B, B M, M R");
+//         Rainbow *rainbow = new(pool) Rainbow(rainbow_standard);
 //         effect = new(pool) StaticRainbowEffect(rainbow);
 //     }
 //     ((StaticRainbowEffect*)effect)->update();
@@ -129,21 +204,55 @@ bool update_show() {
 
 
 void loop() {
-    show_age++;
-    // Keep incrementing the show counter until you succeed
-    // in starting an effect.
-    while (true) {
-        debouncer.update();
-        bool running = update_show();
-        bool dbf = debouncer.fell();
-        if (dbf) Serial.printf("Debouncer fell.\n");
-        if (running && !dbf) break;
-        pool.clear();
-        show_effect = NULL;
-        show_age = 0;
-        show_counter = (show_counter + 1) & 255;
+    frame_clock.wait_for_frame();
+    frame_steps = frame_clock.steps();
+    PROFILE_BEGIN_FRAME(live_show[current_show].counter);
+    led_begin_frame();
+    debouncer.update();
+    bool clicked = debouncer.fell();
+    if (clicked) Serial.printf("Debouncer fell.\n");
+
+    // Render the outgoing show, if there is one, and set it aside.
+    uint32_t transition_age = frame_clock.ticks() - transition_start;
+    if (transitioning && (clicked || (transition_age >= TRANSITION_TICKS))) {
+        end_transition();
+    }
+    if (transitioning) {
+        update_show(current_show ^ 1);
+        led_save(transition_frame);
     }
-    leds.show();
-}
 
+    // Render the current show, and blend it with the outgoing show.
+    bool running = update_show(current_show);
+    if (transitioning) {
+        PROFILE_ENTER(PROFILE_CONVERT);
+        uint32_t blend = micros();
+        led_blend(transition_frame, transition_age * FIXMAX / TRANSITION_TICKS);
+        transition_blend_micros += micros() - blend;
+        transition_frames++;
+    }
 
+    // When the current show ends, start the next one, and begin the
+    // transition.  If a transition is already in progress, the outgoing
+    // show is dropped.
+    if (!running || clicked) {
+        uint32_t counter = live_show[current_show].counter;
+        frame_clock.report(counter);
+        led_swap_stats.report();
+        led_power_report();
+        PROFILE_REPORT(counter, ShowList::name(counter));
+        if (transitioning) end_transition();
+        uint32_t next = (counter + 1) % ShowList::count;
+        current_show ^= 1;
+        start_show(current_show, next);
+        transitioning = true;
+        transition_start = frame_clock.ticks();
+        transition_frames = 0;
+        transition_blend_micros = 0;
+    }
+    PROFILE_ENTER(PROFILE_CONVERT);
+    led_output(frame_steps);
+    PROFILE_ENTER(PROFILE_TRANSMIT);
+    led_swap();
+    PROFILE_ENTER(PROFILE_IDLE);
+}
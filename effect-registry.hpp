@@ -0,0 +1,81 @@
+// Effect Registry
+//
+// The registry is a compile-time list of effect types.  Each effect
+// is a struct with a default constructor, a static 'name' method, and
+// an 'update' method that renders one frame and returns false when the
+// show is over.  To add an effect to the rotation, add its type to the
+// list:
+//
+//   typedef EffectList<ZippyCarEffect, NexusEffect, CometEffect> ShowList;
+//
+// The list generates the code to construct and update the Nth effect.
+// Since the types are all known at compile time, there are no virtual
+// calls and no casts in the effects.  The list also checks that every
+// effect fits in the pool, and it reports the size of the largest
+// effect, so that the pool can be sized to match.
+//
+
+template <typename... Effects>
+struct EffectList;
+
+template <>
+struct EffectList<> {
+    static const int count = 0;
+    static const uint32_t max_size = 0;
+
+    static void *create(int index, PoolAlloc &pool) { return NULL; }
+    static bool update(int index, void *effect) { return false; }
+    static const char *name(int index) { return "none"; }
+    static const char *largest_name() { return "none"; }
+};
+
+template <typename First, typename... Rest>
+struct EffectList<First, Rest...> {
+    typedef EffectList<Rest...> Tail;
+
+    static_assert(POOL_ALLOC_ROUND(sizeof(First)) <= POOL_ALLOC_SIZE,
+                  "Effect is too big for the pool.");
+    static_assert(alignof(First) <= POOL_ALLOC_ALIGN,
+                  "Effect needs more alignment than the pool provides.");
+
+    static const int count = Tail::count + 1;
+    static const uint32_t max_size =
+        (sizeof(First) > Tail::max_size) ? sizeof(First) : Tail::max_size;
+
+    // create
+    //
+    // Construct the Nth effect in the pool.
+
+    static void *create(int index, PoolAlloc &pool) {
+        if (index == 0) return new(pool) First();
+        return Tail::create(index - 1, pool);
+    }
+
+    // update
+    //
+    // Update the Nth effect.  Returns false when the show is over.
+
+    static bool update(int index, void *effect) {
+        if (index == 0) return ((First *)effect)->update();
+        return Tail::update(index - 1, effect);
+    }
+
+    static const char *name(int index) {
+        if (index == 0) return First::name();
+        return Tail::name(index - 1);
+    }
+
+    static const char *largest_name() {
+        if (sizeof(First) >= Tail::max_size) return First::name();
+        return Tail::largest_name();
+    }
+
+    // report
+    //
+    // Print the pool footprint of the largest effect.
+
+    static void report() {
+        Serial.printf("Largest effect: %s, %d of %d pool bytes.\n",
+            largest_name(), int(max_size), int(POOL_ALLOC_SIZE));
+    }
+};
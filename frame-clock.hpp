@@ -0,0 +1,172 @@
+// Frame Clock
+//
+// The frame clock paces the main loop at a fixed frame rate, and it
+// keeps track of how long the current show has been running.  Time
+// is measured in three ways:
+//
+//   - show_micros: microseconds since the show started.
+//   - show_ticks: the number of frame periods since the show started.
+//   - ticks: the number of frame periods since the clock started.
+//
+// Effects read the show time as show_age, the tick count since their
+// show started, which advances by exactly one per frame when the effect
+// keeps up with the frame rate.  When an effect is too slow, the clock
+// skips the frame periods that were missed, so the tick count advances
+// by more than one.  The number of ticks that elapsed during the most
+// recent frame is available as 'steps'.  Effects that accumulate motion
+// from frame to frame should multiply their per-frame increments by
+// 'steps'.  That way, a heavy effect runs at the same visual speed as a
+// cheap one, it just draws fewer frames.  A tick is a fixed length of
+// real time, so this is the same as reading microseconds, in units of
+// a frame period.  show_micros is only used for reporting: during a
+// cross-fade two shows are live, and each keeps its own start tick.
+//
+// The catch-up is bounded.  A frame advances the ticks by at most
+// FRAME_CLOCK_MAX_STEPS, so a long stall, such as a slow Serial write or
+// a debugger halt, doesn't make every particle jump across the solid at
+// once.  The periods beyond that are dropped: they are never drawn, and
+// the show time doesn't count them.
+//
+// The default frame rate keeps the animations at the speed they had
+// when the loop counted one tick per frame, and ran as fast as the wire
+// allowed, which was 135 to 175 frames per second.  A show is 16384
+// ticks, so it lasts about 110 seconds.
+//
+// When the loop finishes a frame early, the clock puts the processor to
+// sleep until the next frame is due.  The clock source and the sleep
+// instruction are both macros, so a host build can substitute a mock
+// clock.
+//
+
+#ifndef FRAME_RATE
+#define FRAME_RATE 150
+#endif
+
+#ifndef FRAME_CLOCK_MAX_STEPS
+#define FRAME_CLOCK_MAX_STEPS 4
+#endif
+
+#define FRAME_MICROS (1000000 / FRAME_RATE)
+
+// The clock source.  Must return a free-running microsecond counter
+// that wraps at 2^32.
+//
+#ifndef FRAME_CLOCK_MICROS
+#define FRAME_CLOCK_MICROS() micros()
+#endif
+
+// Sleep while waiting for the next frame.  The parameter is the number
+// of microseconds remaining.  The SysTick interrupt wakes the processor
+// once per millisecond, so we only sleep when at least that much time
+// remains, and spin for the rest.
+//
+#ifndef FRAME_CLOCK_IDLE
+#if defined(__arm__)
+#define FRAME_CLOCK_IDLE(remaining) do { if ((remaining) > 1000) __WFI(); } while (0)
+#else
+#define FRAME_CLOCK_IDLE(remaining) do { } while (0)
+#endif
+#endif
+
+class FrameClock {
+private:
+    uint32_t deadline_;      // When the next frame is due.
+    uint32_t frame_start_;   // When the current frame started.
+    uint32_t show_start_;    // When the current show started.
+    uint32_t show_ticks_;
+    uint32_t ticks_;
+    uint32_t steps_;
+    uint32_t frames_;
+    uint32_t late_frames_;
+    uint32_t dropped_frames_;
+    uint32_t idle_micros_;
+
+public:
+    // begin
+    //
+    // Start the clock.  The first frame is due immediately.
+
+    void begin() {
+        uint32_t now = FRAME_CLOCK_MICROS();
+        deadline_ = now;
+        frame_start_ = now;
+        show_start_ = now;
+        show_ticks_ = 0;
+        ticks_ = 0;
+        steps_ = 0;
+        frames_ = 0;
+        late_frames_ = 0;
+        dropped_frames_ = 0;
+        idle_micros_ = 0;
+    }
+
+    // restart_show
+    //
+    // Reset the show time and the statistics.  The frame currently in
+    // progress becomes tick zero of the new show.
+
+    void restart_show() {
+        show_start_ = frame_start_;
+        show_ticks_ = 0;
+        frames_ = 1;
+        late_frames_ = 0;
+        dropped_frames_ = 0;
+        idle_micros_ = 0;
+    }
+
+    // wait_for_frame
+    //
+    // Sleep until the next frame is due, then advance the show time.
+    // If we are already past the deadline, the frame is late.  If we
+    // are more than a whole frame period past the deadline, the missed
+    // frame periods are added to the steps, up to FRAME_CLOCK_MAX_STEPS,
+    // and the rest are dropped.
+
+    void wait_for_frame() {
+        uint32_t now = FRAME_CLOCK_MICROS();
+        int32_t remaining = int32_t(deadline_ - now);
+        steps_ = 1;
+        if (remaining >= 0) {
+            uint32_t idle_start = now;
+            while (remaining > 0) {
+                FRAME_CLOCK_IDLE(remaining);
+                now = FRAME_CLOCK_MICROS();
+                remaining = int32_t(deadline_ - now);
+            }
+            idle_micros_ += now - idle_start;
+        } else {
+            late_frames_++;
+            uint32_t missed = uint32_t(-remaining) / FRAME_MICROS;
+            deadline_ += missed * FRAME_MICROS;
+            if (missed > FRAME_CLOCK_MAX_STEPS - 1) {
+                dropped_frames_ += missed - (FRAME_CLOCK_MAX_STEPS - 1);
+                missed = FRAME_CLOCK_MAX_STEPS - 1;
+            }
+            steps_ += missed;
+        }
+        frame_start_ = now;
+        deadline_ += FRAME_MICROS;
+        show_ticks_ += steps_;
+        ticks_ += steps_;
+        frames_++;
+    }
+
+    uint32_t show_micros() const { return frame_start_ - show_start_; }
+    uint32_t show_ticks() const { return show_ticks_; }
+    uint32_t ticks() const { return ticks_; }
+    uint32_t steps() const { return steps_; }
+    uint32_t frames() const { return frames_; }
+    uint32_t late_frames() const { return late_frames_; }
+    uint32_t dropped_frames() const { return dropped_frames_; }
+    uint32_t idle_micros() const { return idle_micros_; }
+
+    // report
+    //
+    // Print the statistics for the current show.
+
+    void report(uint32_t show) const {
+        Serial.printf("Show %d: %d frames in %d ms, %d late, %d dropped, %d ms idle.\n",
+            int(show), int(frames_), int(show_micros() / 1000),
+            int(late_frames_), int(dropped_frames_), int(idle_micros_ / 1000));
+    }
+};
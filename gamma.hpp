@@ -0,0 +1,69 @@
+// Gamma Correction
+//
+// The LEDs' brightness is linear in the PWM duty cycle, but the eye's
+// response is not, so a linear fade spends most of its range on colors
+// that look nearly full brightness and jumps through the dim end in a
+// few coarse steps.  The gamma table maps a linear 15-bit channel to the
+// level that the LED should be driven at.
+//
+// The output is 8.8 fixed point: the high byte is the level sent to the
+// LED, and the low byte is the fraction that the output stage carries
+// over to later frames by temporal dithering.  The table has an entry
+// every 128 input steps, and the lookup interpolates between entries.
+//
+// The table was generated by gen_gamma_table in tablegen.py, with a
+// gamma of 2.2.
+//
+
+#define LED_GAMMA_ENTRIES 258
+#define LED_GAMMA_MAX (255 << 8)
+
+const uint16_t gamma_table[LED_GAMMA_ENTRIES] = {
+        0,     0,     2,     4,     7,    11,    17,    24,
+       32,    41,    52,    64,    78,    93,   109,   127,
+      146,   167,   190,   214,   239,   266,   295,   325,
+      357,   391,   426,   463,   502,   542,   584,   628,
+      673,   720,   769,   820,   872,   926,   982,  1040,
+     1099,  1161,  1224,  1289,  1356,  1425,  1495,  1568,
+     1642,  1718,  1796,  1876,  1958,  2042,  2128,  2215,
+     2305,  2396,  2490,  2585,  2683,  2782,  2883,  2987,
+     3092,  3199,  3309,  3420,  3533,  3649,  3766,  3885,
+     4007,  4130,  4256,  4383,  4513,  4644,  4778,  4914,
+     5052,  5192,  5334,  5478,  5624,  5773,  5923,  6076,
+     6230,  6387,  6546,  6707,  6870,  7036,  7203,  7373,
+     7545,  7719,  7895,  8073,  8254,  8436,  8621,  8808,
+     8998,  9189,  9383,  9578,  9777,  9977, 10179, 10384,
+    10591, 10800, 11011, 11225, 11441, 11659, 11879, 12102,
+    12327, 12554, 12783, 13015, 13249, 13485, 13724, 13964,
+    14207, 14453, 14700, 14950, 15202, 15457, 15714, 15973,
+    16234, 16498, 16764, 17033, 17303, 17577, 17852, 18130,
+    18410, 18692, 18977, 19264, 19554, 19845, 20140, 20436,
+    20735, 21036, 21340, 21646, 21955, 22265, 22579, 22894,
+    23212, 23533, 23855, 24180, 24508, 24838, 25170, 25505,
+    25842, 26182, 26524, 26869, 27215, 27565, 27916, 28271,
+    28627, 28986, 29348, 29712, 30078, 30447, 30818, 31192,
+    31568, 31947, 32328, 32712, 33098, 33486, 33877, 34271,
+    34667, 35065, 35466, 35870, 36276, 36684, 37095, 37508,
+    37924, 38343, 38764, 39187, 39613, 40042, 40473, 40906,
+    41342, 41781, 42222, 42665, 43111, 43560, 44011, 44465,
+    44921, 45380, 45841, 46305, 46772, 47241, 47712, 48186,
+    48663, 49142, 49624, 50108, 50595, 51085, 51577, 52071,
+    52569, 53068, 53571, 54076, 54583, 55093, 55606, 56121,
+    56639, 57160, 57683, 58208, 58737, 59268, 59801, 60337,
+    60876, 61417, 61961, 62508, 63057, 63609, 64163, 64720,
+    65280, 65280,
+};
+
+// gamma_lookup
+//
+// Map a linear channel, 0 to FIXMAX, to an 8.8 output level.  Values
+// above FIXMAX are clamped.
+
+inline uint32_t gamma_lookup(uint32_t v) {
+    if (v > FIXMAX) v = FIXMAX;
+    uint32_t index = v >> 7;
+    uint32_t frac = v & 127;
+    uint32_t lo = gamma_table[index];
+    uint32_t hi = gamma_table[index + 1];
+    return lo + (((hi - lo) * frac) >> 7);
+}
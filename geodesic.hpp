@@ -0,0 +1,154 @@
+// Geodesic Distances
+//
+// Ripples and waves travel along the wire, not through space.  The
+// geodesic distance from a source to an LED is the number of steps
+// along led_adjacency between them, so a ring that expands from the
+// source lights the LEDs whose distance is the ring's radius.
+//
+// Two kinds of source are precomputed, by a breadth-first search at
+// compile time:
+//
+//   - geodesic_from_vertex(v): the three LEDs around vertex v are 0.
+//
+//   - geodesic_from_edge(e): the two LEDs around the middle of edge e
+//     are 0.
+//
+// Each table is a byte per LED, 45000 bytes of flash for all 50, and a
+// ring is a lookup and a compare per LED.  No LED is more than about
+// five edges from any source, so every distance fits in a byte.
+//
+// Sources that move, such as a comet's head, need a search at runtime.
+// A GeodesicField runs the same search from any set of LEDs.  The cost
+// is bounded: each LED that's reached is queued once, and each of its
+// two or three neighbors is checked once.  A limit on the distance
+// stops the search early, so a small ring costs about its area.
+//
+
+#define GEODESIC_VERTICES 20
+#define GEODESIC_SOURCES (GEODESIC_VERTICES + TOTAL_EDGES)
+#define GEODESIC_FAR 0xFF
+
+// geodesic_expand
+//
+// The breadth-first search.  On entry, the first count entries of the
+// queue are the sources, their distances are 0, and every other LED is
+// GEODESIC_FAR.  LEDs up to limit steps away get their distances, and
+// are appended to the queue in order of distance.  Returns the length
+// of the queue.
+
+constexpr int geodesic_expand(uint8_t *distance, uint16_t *queue, int count, int limit) {
+    for (int head = 0; head < count; head++) {
+        int led = queue[head];
+        int next = distance[led] + 1;
+        if (next > limit) break;
+        const uint16_t *adj = led_adjacency.neighbors(led);
+        for (int k = 0; k < led_adjacency.count(led); k++) {
+            if (distance[adj[k]] != GEODESIC_FAR) continue;
+            distance[adj[k]] = next;
+            queue[count++] = adj[k];
+        }
+    }
+    return count;
+}
+
+struct GeodesicTable {
+    uint8_t distance[GEODESIC_SOURCES][TOTAL_LEDS];
+
+    constexpr GeodesicTable() : distance() {
+        uint16_t queue[TOTAL_LEDS] = {};
+        for (int s = 0; s < GEODESIC_SOURCES; s++) {
+            uint8_t *d = distance[s];
+            for (int led = 0; led < TOTAL_LEDS; led++) d[led] = GEODESIC_FAR;
+            int count = 0;
+            if (s < GEODESIC_VERTICES) {
+                for (int e = 0; e < TOTAL_EDGES; e++) {
+                    if (dodecahedron_edge[e].vertex1 == s) queue[count++] = edge_forward(e, 0);
+                    if (dodecahedron_edge[e].vertex2 == s) queue[count++] = edge_backward(e, 0);
+                }
+            } else {
+                int e = s - GEODESIC_VERTICES;
+                queue[count++] = edge_forward(e, LEDS_PER_HALF - 1);
+                queue[count++] = edge_forward(e, LEDS_PER_HALF);
+            }
+            for (int k = 0; k < count; k++) d[queue[k]] = 0;
+            geodesic_expand(d, queue, count, GEODESIC_FAR - 1);
+        }
+    }
+
+    constexpr bool complete() const {
+        for (int s = 0; s < GEODESIC_SOURCES; s++) {
+            for (int led = 0; led < TOTAL_LEDS; led++) {
+                if (distance[s][led] == GEODESIC_FAR) return false;
+            }
+        }
+        return true;
+    }
+};
+
+constexpr GeodesicTable geodesic_table;
+
+static_assert(geodesic_table.complete(), "Every LED is reachable from every source.");
+
+constexpr const uint8_t *geodesic_from_vertex(int v) {
+    return geodesic_table.distance[v];
+}
+
+constexpr const uint8_t *geodesic_from_edge(int e) {
+    return geodesic_table.distance[GEODESIC_VERTICES + e];
+}
+
+// GeodesicField
+//
+// Distances from a set of sources chosen at runtime.  Call clear, add
+// the sources, then expand.  After expand, reached(i) lists the LEDs it
+// reached, nearest first, and distance(led) is GEODESIC_FAR for the
+// LEDs it didn't.
+
+class GeodesicField {
+private:
+    uint8_t distance_[TOTAL_LEDS];
+    uint16_t queue_[TOTAL_LEDS];
+    int count_;
+
+public:
+    GeodesicField() {
+        clear();
+    }
+
+    void clear() {
+        memset(distance_, GEODESIC_FAR, sizeof(distance_));
+        count_ = 0;
+    }
+
+    void add_source(int led) {
+        if (distance_[led] == 0) return;
+        distance_[led] = 0;
+        queue_[count_++] = led;
+    }
+
+    // expand
+    //
+    // Find the distances up to limit, which must be less than
+    // GEODESIC_FAR.  Returns the number of LEDs reached.
+
+    int expand(int limit = GEODESIC_FAR - 1) {
+        count_ = geodesic_expand(distance_, queue_, count_, limit);
+        return count_;
+    }
+
+    uint8_t distance(int led) const {
+        return distance_[led];
+    }
+
+    const uint8_t *distances() const {
+        return distance_;
+    }
+
+    int reached() const {
+        return count_;
+    }
+
+    int reached(int i) const {
+        return queue_[i];
+    }
+};
@@ -25,7 +25,7 @@
 // Coordinates range from -16384 to 16384.
 //
 
-Vector dodecahedron_vertex[20] = {
+constexpr Vector dodecahedron_vertex[20] = {
     {     0,-10125,-13254}, { -9630, -3129,-13254}, { -5951,  8192,-13254}, {  5951,  8192,-13254}, {  9630, -3129,-13254},
     {     0,-16384, -3129}, {-15582, -5062, -3129}, { -9630, 13254, -3129}, {  9630, 13254, -3129}, { 15582, -5062, -3129},
     { -9630,-13254,  3129}, {-15582,  5062,  3129}, {     0, 16384,  3129}, { 15582,  5062,  3129}, {  9630,-13254,  3129},
@@ -46,11 +46,11 @@ Vector dodecahedron_vertex[20] = {
 //
 
 struct DodecahedronEdge {
-    int vertex1;
-    int vertex2;
+    uint8_t vertex1;
+    uint8_t vertex2;
 };
 
-DodecahedronEdge dodecahedron_edge[] = {
+constexpr DodecahedronEdge dodecahedron_edge[] = {
     { 0,  1}, { 1,  6}, { 6, 11}, {11, 16}, {16, 17}, {11,  7},
     { 1,  2}, { 2,  7}, { 7, 12}, {12, 17}, {17, 18}, {12,  8},
     { 2,  3}, { 3,  8}, { 8, 13}, {13, 18}, {18, 19}, {13,  9},
@@ -58,136 +58,127 @@ DodecahedronEdge dodecahedron_edge[] = {
     { 4,  0}, { 0,  5}, { 5, 10}, {10, 15}, {15, 16}, {10,  6},
 };
 
-Vector dod_get_edge_vertex1(int edge) {
+constexpr Vector dod_get_edge_vertex1(int edge) {
     return dodecahedron_vertex[dodecahedron_edge[edge].vertex1];
 }
 
-Vector dod_get_edge_vertex2(int edge) {
+constexpr Vector dod_get_edge_vertex2(int edge) {
     return dodecahedron_vertex[dodecahedron_edge[edge].vertex2];
 }
 
 // DirectedEdge
 //
 // Stores an edge and a direction.
+//
+// A DirectedEdge also packs into a byte: the edge number times two, plus
+// one if it is backward.  Tables of directed edges use the packed form.
 // 
 
+typedef uint8_t PackedEdge;
+
 struct DirectedEdge {
     int edge;
     bool backward;
     
     // Constructors.
-    DirectedEdge() : edge(-1), backward(false) {}
-    DirectedEdge(int e, bool b) : edge(e), backward(b) {}
+    constexpr DirectedEdge() : edge(-1), backward(false) {}
+    constexpr DirectedEdge(int e, bool b) : edge(e), backward(b) {}
+
+    // Packing and unpacking.
+    constexpr PackedEdge pack() const {
+        return (edge << 1) | (backward ? 1 : 0);
+    }
+    static constexpr DirectedEdge unpack(PackedEdge packed) {
+        return DirectedEdge(packed >> 1, (packed & 1) != 0);
+    }
     
     // Return the LED index of the Nth LED.
-    int offset(int i) const {
-        if (backward) {
-            return edge_backward(edge, i);
-        } else {
-            return edge_forward(edge, i);
-        }
+    constexpr int offset(int i) const {
+        return backward ? edge_backward(edge, i) : edge_forward(edge, i);
     }
     
     // Return the opposite of this DirectedEdge.
-    DirectedEdge uturn() const {
+    constexpr DirectedEdge uturn() const {
         return DirectedEdge(edge, !backward);
     }
     
     // Get the vertices at the start and end of the edge.
-    Vector vertex1() const {
-        if (backward) {
-            return dodecahedron_vertex[dodecahedron_edge[edge].vertex2];
-        } else {
-            return dodecahedron_vertex[dodecahedron_edge[edge].vertex1];
-        }
+    constexpr int vertex1_index() const {
+        return backward ? dodecahedron_edge[edge].vertex2 : dodecahedron_edge[edge].vertex1;
     }
-    Vector vertex2() const {
-        if (backward) {
-            return dodecahedron_vertex[dodecahedron_edge[edge].vertex1];
-        } else {
-            return dodecahedron_vertex[dodecahedron_edge[edge].vertex2];
-        }
+    constexpr int vertex2_index() const {
+        return backward ? dodecahedron_edge[edge].vertex1 : dodecahedron_edge[edge].vertex2;
+    }
+    constexpr Vector vertex1() const {
+        return dodecahedron_vertex[vertex1_index()];
+    }
+    constexpr Vector vertex2() const {
+        return dodecahedron_vertex[vertex2_index()];
     }
     
     // Return the forward and backward vectors.
-    Vector forward_vector() const {
+    constexpr Vector forward_vector() const {
         return vertex2().sub(vertex1());
     }
-    Vector backward_vector() const {
+    constexpr Vector backward_vector() const {
         return vertex1().sub(vertex2());
     }
     
     // Return one successor of this DirectedEdge.
-    DirectedEdge successor(bool left) const;
+    constexpr DirectedEdge successor(bool left) const;
 };
 
 // Successor edge table.
 //
+// When you reach the end of a directed edge, two other edges continue
+// from that vertex: one to the left, one to the right, as seen from
+// outside the dodecahedron.  successor_table.next[packed][left] is the
+// packed successor.  The compiler works out left and right from the
+// cross product of the edge's center and direction, and stores the
+// table in flash.
+//
 
-struct SuccessorEdges {
-    DirectedEdge left_forward;
-    DirectedEdge right_forward;
-    DirectedEdge left_backward;
-    DirectedEdge right_backward;
-};
-
-SuccessorEdges successor_edges[TOTAL_EDGES];
-
-DirectedEdge DirectedEdge::successor(bool left) const {
-    const SuccessorEdges &successors = successor_edges[edge];
-    if (backward) {
-        if (left) {
-            return successors.left_backward;
-        } else {
-            return successors.right_backward;
-        }
-    } else {
-        if (left) {
-            return successors.left_forward;
-        } else {
-            return successors.right_forward;
+#define PACKED_EDGES (TOTAL_EDGES * 2)
+#define NO_PACKED_EDGE 0xFF
+
+struct SuccessorTable {
+    PackedEdge next[PACKED_EDGES][2];
+
+    constexpr SuccessorTable() : next() {
+        for (int packed = 0; packed < PACKED_EDGES; packed++) {
+            next[packed][0] = next[packed][1] = NO_PACKED_EDGE;
+            DirectedEdge de = DirectedEdge::unpack(packed);
+            Vector vtx1 = de.vertex1();
+            Vector vtx2 = de.vertex2();
+            Vector center = vtx1.add(vtx2).div(2);
+            Vector right = center.cross(vtx2.sub(vtx1)).div(32768);
+            int end = de.vertex2_index();
+            for (int other = 0; other < TOTAL_EDGES; other++) {
+                if (other == de.edge) continue;
+                int q1 = dodecahedron_edge[other].vertex1;
+                int q2 = dodecahedron_edge[other].vertex2;
+                if ((q1 != end) && (q2 != end)) continue;
+                DirectedEdge successor(other, (q2 == end));
+                bool left = (right.dot(successor.forward_vector()) <= 0);
+                next[packed][left ? 1 : 0] = successor.pack();
+            }
         }
     }
-}
 
-void populate_successor_edges() {
-    for (int edge = 0; edge < TOTAL_EDGES; edge++) {
-        SuccessorEdges &se = successor_edges[edge];
-        int v1 = dodecahedron_edge[edge].vertex1;
-        int v2 = dodecahedron_edge[edge].vertex2;
-        Vector vtx1 = dodecahedron_vertex[v1];
-        Vector vtx2 = dodecahedron_vertex[v2];
-        Vector center = vtx1.add(vtx2).div(2);
-        Vector forward = vtx2.sub(vtx1);
-        Vector backward = vtx1.sub(vtx2);
-        Vector right_forward = center.cross(forward).div(32768);
-        Vector right_backward = center.cross(backward).div(32768);
-        //Serial.printf("edge %d: v1=%d v2=%d\n", edge, v1, v2);
-        for (int other = 0; other < TOTAL_EDGES; other++) {
-            if (other == edge) continue;
-            int q1 = dodecahedron_edge[other].vertex1;
-            int q2 = dodecahedron_edge[other].vertex2;
-            if ((q1 == v1) || (q2 == v1)) {
-                DirectedEdge successor(other, (q2 == v1));
-                if (right_backward.dot(successor.forward_vector()) > 0) {
-                    //Serial.printf(" -- right backward: %d %d   (v1:%d v2:%d   q1:%d q2:%d)\n", successor.edge, int(successor.backward), v1, v2, q1, q2);
-                    se.right_backward = successor;
-                } else {
-                    //Serial.printf(" -- left backward : %d %d   (v1:%d v2:%d   q1:%d q2:%d)\n", successor.edge, int(successor.backward), v1, v2, q1, q2);
-                    se.left_backward = successor;
-                }
-            } else if ((q1 == v2) || (q2 == v2)) {
-                DirectedEdge successor(other, (q2 == v2));
-                if (right_forward.dot(successor.forward_vector()) > 0) {
-                    //Serial.printf(" -- right forward : %d %d   (v1:%d v2:%d   q1:%d q2:%d)\n", successor.edge, int(successor.backward), v1, v2, q1, q2);
-                    se.right_forward = successor;
-                } else {
-                    //Serial.printf(" -- left forward  : %d %d   (v1:%d v2:%d   q1:%d q2:%d)\n", successor.edge, int(successor.backward), v1, v2, q1, q2);
-                    se.left_forward = successor;
-                }
-            }
+    constexpr bool complete() const {
+        for (int packed = 0; packed < PACKED_EDGES; packed++) {
+            if ((next[packed][0] == NO_PACKED_EDGE) || (next[packed][1] == NO_PACKED_EDGE)) return false;
         }
+        return true;
     }
+};
+
+constexpr SuccessorTable successor_table;
+
+static_assert(successor_table.complete(), "Every directed edge has a left and a right successor.");
+
+constexpr DirectedEdge DirectedEdge::successor(bool left) const {
+    return unpack(successor_table.next[pack()][left ? 1 : 0]);
 }
 
 // Any given LED can have either two or three adjacent LEDS.
@@ -195,34 +186,26 @@ void populate_successor_edges() {
 struct AdjacentLEDs {
     int led[3];
     
-    bool have_three() const {
+    constexpr bool have_three() const {
         return led[2] >= 0;
     }
     
-    int count() const {
+    constexpr int count() const {
         return have_three() ? 3 : 2;
     }
     
-    AdjacentLEDs(int edge, int offset) {
+    constexpr AdjacentLEDs(int edge, int offset) : led() {
         if (offset == 0) {
-            const SuccessorEdges &successors = successor_edges[edge];
-            int e1 = successors.left_backward.edge;
-            int b1 = successors.left_backward.backward;
-            int e2 = successors.right_backward.edge;
-            int b2 = successors.right_backward.backward;
-            led[0] = b1 ? edge_backward(e1, 0) : edge_forward(e1, 0);
-            led[1] = b2 ? edge_backward(e2, 0) : edge_forward(e2, 0);
+            DirectedEdge back(edge, true);
+            led[0] = back.successor(true).offset(0);
+            led[1] = back.successor(false).offset(0);
             led[2] = edge_forward(edge, 1);
             return;
         }
         if (offset == (LEDS_PER_EDGE - 1)) {
-            const SuccessorEdges &successors = successor_edges[edge];
-            int e1 = successors.left_forward.edge;
-            int b1 = successors.left_forward.backward;
-            int e2 = successors.right_forward.edge;
-            int b2 = successors.right_forward.backward;
-            led[0] = b1 ? edge_backward(e1, 0) : edge_forward(e1, 0);
-            led[1] = b2 ? edge_backward(e2, 0) : edge_forward(e2, 0);
+            DirectedEdge fwd(edge, false);
+            led[0] = fwd.successor(true).offset(0);
+            led[1] = fwd.successor(false).offset(0);
             led[2] = edge_backward(edge, 1);
             return;
         }
@@ -232,5 +215,41 @@ struct AdjacentLEDs {
     }
 };
 
+// LED adjacency graph.
+//
+// The neighbors of every LED, in compressed sparse row form: the
+// neighbors of LED i are neighbor[start[i]] through neighbor[start[i+1]-1],
+// in the same order as AdjacentLEDs.  The compiler builds the graph and
+// stores it in flash, so finding a neighbor is a plain array read.
+//
+
+#define LED_NEIGHBORS (TOTAL_EDGES * ((LEDS_PER_EDGE * 2) + 2))
+
+struct LedAdjacency {
+    uint16_t start[TOTAL_LEDS + 1];
+    uint16_t neighbor[LED_NEIGHBORS];
+
+    constexpr LedAdjacency() : start(), neighbor() {
+        int n = 0;
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            AdjacentLEDs adj(led / LEDS_PER_EDGE, led % LEDS_PER_EDGE);
+            start[led] = n;
+            for (int k = 0; k < adj.count(); k++) {
+                neighbor[n++] = adj.led[k];
+            }
+        }
+        start[TOTAL_LEDS] = n;
+    }
+
+    constexpr int count(int led) const {
+        return start[led + 1] - start[led];
+    }
+
+    constexpr const uint16_t *neighbors(int led) const {
+        return neighbor + start[led];
+    }
+};
 
+constexpr LedAdjacency led_adjacency;
 
+static_assert(led_adjacency.start[TOTAL_LEDS] == LED_NEIGHBORS, "LED_NEIGHBORS must match the graph.");
@@ -3,56 +3,58 @@
 #define ZIPPY_CARS 100
 #define ZIPPY_LOOKAHEAD 3
 
-struct ZippyCar {
-    DirectedEdge edge;
-    fpixels position;
-    bool plan_left[3];
-    int speed;
-};
+// The brightness along a car, from its tail to its head.
+constexpr CurveTable<3> zippy_car_profile(CurveKnots(0, FIXMAX * 3 / 8, FIXMAX * 5 / 8, FIXMAX * 6 / 8, FIXMAX * 7 / 8, FIXMAX, FIXMAX, FIXMAX, 0));
+
+// Cars are particles.  The position is in fpixels along the edge, and
+// the turns are the plan for the next ZIPPY_LOOKAHEAD vertices.
 
 struct ZippyCarEffect {
     RGB color_[TOTAL_LEDS];
-    ZippyCar car_[ZIPPY_CARS];
-    int active_cars_;
+    Particles<ZIPPY_CARS> cars_;
     int background_phase_;
+    Prng rng_;
+
+    static const char *name() { return "ZippyCarEffect"; }
     
     ZippyCarEffect() {
+        rng_ = prng_new_stream();
         for (int i = 0; i < TOTAL_LEDS; i++) {
             color_[i] = RGB(0,0,0);
         }
-        active_cars_ = 0;
         background_phase_ = 0;
     }
     
     void kill_one_car() {
-        if (active_cars_ > 0) {
-            int index = random(active_cars_);
-            car_[index] = car_[active_cars_ - 1];
-            active_cars_ -= 1;
+        if (cars_.live() > 0) {
+            cars_.kill(rng_.below(cars_.live()));
         }
     }
     
     void start_new_car() {
-        if (active_cars_ < ZIPPY_CARS) {
-            ZippyCar p;
-            p.edge.edge = random(TOTAL_EDGES);
-            p.edge.backward = (random(2) == 0);
-            p.position = 0;
+        if (!cars_.full()) {
+            int edge = rng_.below(TOTAL_EDGES);
+            bool backward = rng_.coin();
+            uint8_t turns = 0;
             for (int i = 0; i < ZIPPY_LOOKAHEAD; i++) {
-                p.plan_left[i] = (random(2) == 0);
+                turns |= rng_.coin() << i;
             }
-            p.speed = random(25) + 10;
-            car_[active_cars_] = p;
-            active_cars_ ++;
+            int speed = rng_.below(25) + 10;
+            int c = cars_.spawn();
+            cars_.edge[c] = DirectedEdge(edge, backward).pack();
+            cars_.position[c] = 0;
+            cars_.turns[c] = turns;
+            cars_.speed[c] = speed;
         }
     }
     
     void draw_car(const DirectedEdge &edge, fixed intensity, int start_fpixels, int end_fpixels) {
         int px_lo = clamp(0, LEDS_PER_EDGE - 1, fpixels_round_up(start_fpixels));
         int px_hi = clamp(0, LEDS_PER_EDGE - 1, fpixels_round_down(end_fpixels));
+        UnlerpStepper offsets(start_fpixels, end_fpixels, pixels_to_fpixels(px_lo), pixels_to_fpixels(1));
         for (int px = px_lo; px <= px_hi; px++) {
-            fixed offset = fixed_unlerp(start_fpixels, end_fpixels, pixels_to_fpixels(px));
-            fixed brite = spline8(offset, 0, FIXMAX * 3 / 8, FIXMAX * 5 / 8, FIXMAX * 6 / 8, FIXMAX * 7 / 8, FIXMAX, FIXMAX, FIXMAX, 0);
+            fixed offset = offsets.next();
+            fixed brite = zippy_car_profile(offset);
             brite = fixed_mul(brite, intensity);
             RGB acolor(brite, brite, brite);
             int index = edge.offset(px);
@@ -69,10 +71,10 @@ struct ZippyCarEffect {
         int fade_black = spline8(age,  0, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, 0);
 
         int car_count = 3;
-        while (active_cars_ < car_count) start_new_car();
-        while (active_cars_ > car_count) kill_one_car();
+        while (cars_.live() < car_count) start_new_car();
+        while (cars_.live() > car_count) kill_one_car();
 
-        background_phase_ += 20;
+        background_phase_ += 20 * frame_steps;
         for (int edge = 0; edge < TOTAL_EDGES; edge++) {
             fixed hue = ((edge * 5000) + background_phase_) & (FIXMAX - 1);
             RGB color = hue_sat(hue, FIXMAX).brighten();
@@ -82,10 +84,10 @@ struct ZippyCarEffect {
             }
         }
 
-        for (int i = 0; i < active_cars_; i++) {
-            ZippyCar &car = car_[i];
-            DirectedEdge edge = car.edge;
-            int start_fpixels = car.position;
+        for (int i = 0; i < cars_.live(); i++) {
+            int c = cars_.slot(i);
+            DirectedEdge edge = cars_.directed_edge(c);
+            int start_fpixels = cars_.position[c];
             int end_fpixels = start_fpixels + car_length_fpixels;
             int next_plan_step = 0;
             while (true) {
@@ -94,58 +96,67 @@ struct ZippyCarEffect {
                 if (next_plan_step == ZIPPY_LOOKAHEAD) break;
                 start_fpixels -= edge_len_fpixels;
                 end_fpixels -= edge_len_fpixels;
-                edge = edge.successor(car.plan_left[next_plan_step]);
+                edge = edge.successor((cars_.turns[c] >> next_plan_step) & 1);
                 next_plan_step++;
             }
-            car.position += (car.speed * car_speed_mult / 100);
-            if (car.position >= edge_len_fpixels) {
-                car.position -= edge_len_fpixels;
-                car.edge = car.edge.successor(car.plan_left[0]);
-                for (int la = 1; la < ZIPPY_LOOKAHEAD; la++) {
-                    car.plan_left[la - 1] = car.plan_left[la];
-                }
-                car.plan_left[ZIPPY_LOOKAHEAD - 1] = (random(2) == 0);
-            }
-        }
-        for (int i = 0; i < TOTAL_LEDS; i++) {
-            leds.setPixelColor(i, color_[i].scale(fade_black).neocolor_unsafe());
         }
+        cars_.advance(frame_steps, car_speed_mult);
+        cars_.follow_paths(edge_len_fpixels, ZIPPY_LOOKAHEAD, rng_);
+        cars_.tick(frame_steps);
+        PROFILE_ENTER(PROFILE_CONVERT);
+        rgb_scale_span(led_frame, color_, fade_black, TOTAL_LEDS);
         return age < FIXMAX;
     }
 };
 
+// The two brightness waves that run along a burst.
+constexpr CurveTable<3> burst_wave1(CurveKnots(0, FIXMAX/3, FIXMAX, FIXMAX/2, FIXMAX/4, FIXMAX/8, FIXMAX/12, FIXMAX/16, 0));
+constexpr CurveTable<2> burst_wave2(CurveKnots(0, FIXMAX/4, FIXMAX, FIXMAX/4, 0));
+
+// Every edge shows the same pattern, mirrored around its middle, so the
+// burst renders the full group's fundamental domain: the first half of
+// one edge.
+
 struct BurstEffect {
-    EdgeData edge_;
+    RGB rows_[full_symmetry.rows];
     fixed base_hue_;
     fixed hue_range_;
+
+    static const char *name() { return "BurstEffect"; }
     
     BurstEffect(fixed base_hue, fixed hue_range) :
         base_hue_(base_hue), hue_range_(hue_range) {
         }
+
+    BurstEffect() :
+        base_hue_(20000), hue_range_(9000) {
+        }
         
-    void update() {
-        for (int i = 0; i < LEDS_PER_HALF; i++) {
+    bool update() {
+        for (int i = 0; i < full_symmetry.rows; i++) {
             uint32_t index1 = (show_age * 200 + i * 1200);
-            uint32_t bright1 = spline8(index1 & 0x7FFF, 0, FIXMAX/3, FIXMAX, FIXMAX/2, FIXMAX/4, FIXMAX/8, FIXMAX/12, FIXMAX/16, 0);
+            uint32_t bright1 = burst_wave1(index1 & 0x7FFF);
             uint32_t index2 = (show_age * 931 + i * 7000);
-            uint32_t bright2 = spline4(index2 & 0x7FFF, 0, FIXMAX/4, FIXMAX, FIXMAX/4, 0);
+            uint32_t bright2 = burst_wave2(index2 & 0x7FFF);
             fixed bright = fixed_clamp(bright1 + (bright2/8));
             fixed sat = 32768 - (bright2 >> 2);
             fixed hue_offset = spline2((show_age * 15) & 0x7FFF, 0, hue_range_, 0);
             fixed hue = (base_hue_ + hue_offset + (bright1 >> 2)) & 0x7FFF;
-            RGB rgb = hue_sat(hue, sat).scale(bright);
-            uint32_t neocolor = rgb.neocolor_unsafe();
-            edge_.data[i] = neocolor;
-            edge_.data[LEDS_PER_EDGE - 1 - i] = neocolor;
+            rows_[i] = hue_sat(hue, sat).scale(bright);
         }
-        edge_.data[0] = 0;
-        edge_.data[LEDS_PER_EDGE - 1] = 0;
-        edge_.write_all();
+        rows_[0] = RGB(0, 0, 0);
+        PROFILE_ENTER(PROFILE_CONVERT);
+        full_symmetry.scatter(rows_);
+        return show_age * 2 < FIXMAX;
     }
 };
 
 
 struct WaterFallEffect {
+    RGB rows_[WaterfallMap::rows];
+
+    static const char *name() { return "WaterFallEffect"; }
+
     WaterFallEffect() {
     }
         
@@ -155,7 +166,7 @@ struct WaterFallEffect {
         int fade_black =     spline8(age,  0, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, 0);
         int rainbow_pack = spline8(age, FIXMAX/8, FIXMAX/8, FIXMAX/2, FIXMAX/8, FIXMAX/8, FIXMAX/3, FIXMAX, FIXMAX/8, FIXMAX/8);
         int ripple_desat = spline6(age, FIXHALF, FIXHALF/2, 0, 0, FIXHALF, FIXHALF, 0);
-        for (int i = 0; i < SPC_WATERFALL_LENGTH; i++) {
+        for (int i = 0; i < WaterfallMap::rows; i++) {
             int boffset = ((show_age * 150) + (i * 4500)) & 0x7FFF;
             int brite = spline2(boffset, ripple_brightness, 32768, ripple_brightness);
             int pack = fixed_mul(800, rainbow_pack);
@@ -165,9 +176,10 @@ struct WaterFallEffect {
             int soffset = ((show_age * 13) + (i * 1023)) & 0x7FFF;
             int saturation = spline2(soffset, ripple_desat, FIXMAX, ripple_desat);
             rgb = white.lerp(rgb, saturation);
-            rgb = rgb.scale(fade_black);
-            spc_waterfall(i, rgb.neocolor_unsafe());
+            rows_[i] = rgb.scale(fade_black);
         }
+        PROFILE_ENTER(PROFILE_CONVERT);
+        waterfall_projection.scatter(rows_);
         return age < FIXMAX;
     }
 };
@@ -179,30 +191,28 @@ struct FullWhiteEffect {
         
     void update() {        
         RGB rgb(FIXMAX, FIXMAX, FIXMAX);
-        for (int x = 0; x < TOTAL_LEDS; x++) {
-            uint32_t neocolor = rgb.neocolor_unsafe();
-            leds.setPixelColor(x, neocolor);
-        }
+        led_fill(0, TOTAL_LEDS, rgb);
     }
 };
 
 struct BoundariesEffect {
+    static const char *name() { return "BoundariesEffect"; }
+
     BoundariesEffect() {
     }
     
-    void update() {
+    bool update() {
         for (int edge = 0; edge < TOTAL_EDGES; edge++) {
             fixed hue = ((edge * 5000) + (show_age * 20)) & (FIXMAX - 1);
-            uint32_t color1 = hue_sat(hue, FIXMAX).neocolor_unsafe();
-            uint32_t color2 = hue_sat(hue, 5000).neocolor_unsafe();
+            RGB color1 = hue_sat(hue, FIXMAX);
+            RGB color2 = hue_sat(hue, 5000);
             int offset = (edge * LEDS_PER_EDGE);
             int last = (LEDS_PER_EDGE - 1);
-            for (int i = 0; i < LEDS_PER_EDGE; i++) {
-                leds.setPixelColor(i + offset, color1);
-            }
-            leds.setPixelColor(0 + offset, color2);
-            leds.setPixelColor(last + offset, color2);
+            led_fill(offset, LEDS_PER_EDGE, color1);
+            led_write(0 + offset, color2);
+            led_write(last + offset, color2);
         }
+        return show_age * 2 < FIXMAX;
     }
 };
 
@@ -210,25 +220,36 @@ struct BoundariesEffect {
 struct LittleCarEffect {
     DirectedEdge edge_;
     int offset_;
+    uint32_t step_ticks_;
     bool next_left_;
+    Prng rng_;
+
+    static const char *name() { return "LittleCarEffect"; }
     
     LittleCarEffect() {
+        rng_ = prng_new_stream();
         edge_ = DirectedEdge(0, false);
         offset_ = 0;
+        // The first frame takes the first step, as tick 0 did before.
+        step_ticks_ = 63;
         next_left_ = false;
     }
     bool update() {
-        uint32_t red = RGB(FIXMAX, 0, 0).neocolor_unsafe();
-        uint32_t blue = RGB(0, 0, FIXMAX).neocolor_unsafe();
-        uint32_t white = RGB(FIXMAX, FIXMAX, FIXMAX).neocolor_unsafe();
+        RGB red(FIXMAX, 0, 0);
+        RGB blue(0, 0, FIXMAX);
+        RGB white(FIXMAX, FIXMAX, FIXMAX);
         
         if (show_age*2 > FIXMAX) return false;
-        if ((show_age & 0x3F) == 0) {
+        // The car moves one LED every 64 ticks.  Dropped frames are
+        // made up by taking several steps at once.
+        step_ticks_ += frame_steps;
+        while (step_ticks_ >= 64) {
+            step_ticks_ -= 64;
             if (offset_ == LEDS_PER_EDGE - 1) {
                 DirectedEdge next = edge_.successor(next_left_);
                 offset_ = 0;
                 edge_ = next;
-                next_left_ = (random(2) == 0);
+                next_left_ = rng_.coin();
             } else {
                 offset_ ++;
             }
@@ -236,12 +257,12 @@ struct LittleCarEffect {
         clear_leds();
         int index = edge_.offset(offset_);
         if (offset_ < LEDS_PER_HALF) {
-            leds.setPixelColor(index, white);
+            led_write(index, white);
         } else {
             if (next_left_) {
-                leds.setPixelColor(index, red);
+                led_write(index, red);
             } else {
-                leds.setPixelColor(index, blue);
+                led_write(index, blue);
             }
         }
         return true;
@@ -0,0 +1,104 @@
+// Adafruit_NeoPXL8 stand-in for the host build.
+//
+// Keeps a pixel buffer in the same layout as the real driver: 8 outputs,
+// each with the same number of pixels, three bytes per pixel in the
+// order given by the color-order constant.  It also models the time it
+// takes to send a frame over the wire, so that waiting on the driver
+// shows up on the mock clock.
+//
+
+#ifndef HOST_ADAFRUIT_NEOPXL8_H
+#define HOST_ADAFRUIT_NEOPXL8_H
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_RBG ((0 << 6) | (0 << 4) | (2 << 2) | (1))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_GBR ((2 << 6) | (2 << 4) | (0 << 2) | (1))
+#define NEO_BRG ((1 << 6) | (1 << 4) | (2 << 2) | (0))
+#define NEO_BGR ((2 << 6) | (2 << 4) | (1 << 2) | (0))
+
+// Each bit takes 1.25 microseconds at 800 kHz, and the strands need a
+// 300 microsecond latch between frames.
+//
+#define HOST_NEOPXL8_MICROS_PER_PIXEL 30
+#define HOST_NEOPXL8_LATCH_MICROS 300
+
+class Adafruit_NeoPXL8 {
+private:
+    uint16_t length_;
+    uint16_t num_pixels_;
+    uint8_t *pixels_;
+    uint8_t r_offset_;
+    uint8_t g_offset_;
+    uint8_t b_offset_;
+    uint16_t brightness_;
+    bool double_buffer_;
+    bool staged_;
+    uint64_t busy_until_;
+
+    bool sending() const { return host_clock_micros() < busy_until_; }
+
+    // The real driver spins in these situations.  We advance the clock
+    // instead, so that fixed-cost runs don't spin forever.
+    void wait_until_idle() {
+        uint64_t now = host_clock_micros();
+        if (now < busy_until_) host_clock_advance(busy_until_ - now);
+    }
+
+public:
+    Adafruit_NeoPXL8(uint16_t n, int8_t *pins, uint32_t type) :
+        length_(n), num_pixels_(n * 8),
+        pixels_((uint8_t *)calloc(n * 8 * 3, 1)),
+        r_offset_((type >> 4) & 3), g_offset_((type >> 2) & 3), b_offset_(type & 3),
+        brightness_(0), double_buffer_(false), staged_(false), busy_until_(0) {
+    }
+
+    bool begin(bool dbuf = false) {
+        double_buffer_ = dbuf;
+        return true;
+    }
+
+    void setBrightness(uint8_t b) { brightness_ = uint16_t(b) + 1; }
+
+    void setPixelColor(uint16_t n, uint32_t c) {
+        if (n >= num_pixels_) return;
+        uint8_t r = c >> 16;
+        uint8_t g = c >> 8;
+        uint8_t b = c;
+        if (brightness_ != 0 && brightness_ != 256) {
+            r = (r * brightness_) >> 8;
+            g = (g * brightness_) >> 8;
+            b = (b * brightness_) >> 8;
+        }
+        uint8_t *p = pixels_ + n * 3;
+        p[r_offset_] = r;
+        p[g_offset_] = g;
+        p[b_offset_] = b;
+    }
+
+    uint8_t *getPixels() const { return pixels_; }
+    uint16_t numPixels() const { return num_pixels_; }
+
+    bool canStage() {
+        if (double_buffer_ || !sending()) return true;
+        wait_until_idle();
+        return false;
+    }
+
+    bool canShow() {
+        if (!sending()) return true;
+        wait_until_idle();
+        return false;
+    }
+
+    void stage() { staged_ = true; }
+
+    void show() {
+        wait_until_idle();
+        staged_ = false;
+        busy_until_ = host_clock_micros() +
+            length_ * HOST_NEOPXL8_MICROS_PER_PIXEL + HOST_NEOPXL8_LATCH_MICROS;
+    }
+};
+
+#endif
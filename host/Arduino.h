@@ -0,0 +1,129 @@
+// Arduino stand-ins for the host build.
+//
+// The host build compiles the sketch with a normal C++ compiler, so that
+// effects can be profiled and regression-tested on a workstation.  This
+// header provides just enough of the Arduino core to compile the sketch:
+// Serial, random, analogRead, delay, and a mock microsecond clock.
+//
+// The mock clock runs at real time, plus however much time the sketch
+// has spent "sleeping."  Sleeping doesn't really sleep, it just advances
+// the clock, so the simulator runs as fast as the effects can render.
+// In fixed-cost mode, the clock ignores real time entirely, and the
+// simulator charges a fixed number of microseconds per frame instead.
+// That makes a run completely deterministic.
+//
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <new>
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define F_CPU 120000000
+
+// The mock clock.
+//
+
+uint64_t host_clock_micros();
+void host_clock_advance(uint64_t us);
+
+inline uint32_t micros() { return uint32_t(host_clock_micros()); }
+inline uint32_t millis() { return uint32_t(host_clock_micros() / 1000); }
+inline void delay(uint32_t ms) { host_clock_advance(uint64_t(ms) * 1000); }
+
+#define FRAME_CLOCK_IDLE(remaining) host_clock_advance(remaining)
+
+// Stands in for the Cortex-M cycle counter.  Counts mock clock time,
+// at nanosecond resolution, in units of F_CPU cycles.
+//
+
+uint32_t host_cycle_count();
+
+// Serial.
+//
+
+struct HostSerial {
+    void begin(int baud) {}
+    int printf(const char *format, ...) {
+        va_list args;
+        va_start(args, format);
+        int result = vprintf(format, args);
+        va_end(args);
+        return result;
+    }
+};
+
+extern HostSerial Serial;
+
+// Random numbers.  This is a small deterministic generator, so that a
+// given seed always replays the same show.
+//
+
+extern uint32_t host_random_state;
+
+inline uint32_t host_random_next() {
+    uint32_t x = host_random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    host_random_state = x;
+    return x;
+}
+
+inline long random(long howbig) {
+    if (howbig <= 0) return 0;
+    return host_random_next() % howbig;
+}
+
+inline long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+inline void randomSeed(unsigned long seed) {
+    host_random_state = (seed == 0) ? 1 : seed;
+}
+
+// Analog and digital pins.  The analog pins return noise derived from
+// the simulator's seed.
+//
+
+extern uint32_t host_analog_state;
+
+inline int analogRead(int pin) {
+    host_analog_state = host_analog_state * 1664525 + 1013904223 + pin;
+    return (host_analog_state >> 16) & 1023;
+}
+
+inline void pinMode(int pin, int mode) {}
+inline int digitalRead(int pin) { return 1; }
+
+// The Arduino core's min and max accept mixed argument types.
+//
+
+template<class T, class L>
+auto min(const T& a, const L& b) -> decltype((b < a) ? b : a) {
+    return (b < a) ? b : a;
+}
+
+template<class T, class L>
+auto max(const T& a, const L& b) -> decltype((b < a) ? b : a) {
+    return (a < b) ? b : a;
+}
+
+#endif
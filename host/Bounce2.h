@@ -0,0 +1,16 @@
+// Bounce2 stand-in for the host build.  The button is never pressed.
+//
+
+#ifndef HOST_BOUNCE2_H
+#define HOST_BOUNCE2_H
+
+class Bounce {
+public:
+    void attach(int pin, int mode) {}
+    void interval(uint16_t ms) {}
+    bool update() { return false; }
+    bool fell() { return false; }
+    bool rose() { return false; }
+};
+
+#endif
@@ -0,0 +1,11 @@
+// Runs the microbenchmarks in bench.hpp on the host.
+//
+
+#define BENCHMARK
+
+#include "../dodecahedron.ino"
+#include "host-support.hpp"
+
+int main(int argc, char **argv) {
+    return (run_benchmarks() == 0) ? 0 : 1;
+}
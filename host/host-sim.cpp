@@ -0,0 +1,133 @@
+// Headless simulator.
+//
+// Compiles the whole sketch for the host, and runs setup() and loop()
+// for a given number of frames.  It reports how long each frame took to
+// compute, both per frame and totaled per effect.  It can also dump the
+// frames to a file, for regression testing or for visualization.
+//
+// Usage:
+//
+//   host-sim [--frames N] [--seed S] [--dump FILE] [--times FILE] [--fixed-cost US]
+//
+//   --frames N       Number of frames to run (default 10000).
+//   --seed S         Seed for the analog noise that seeds the random numbers.
+//   --dump FILE      Write every frame to FILE.  Each frame is TOTAL_LEDS
+//                    pixels, in canonical LED order, three bytes per pixel,
+//                    in R, G, B order.
+//   --times FILE     Write the compute time of every frame to FILE, as
+//                    text, one line per frame: frame, show, microseconds.
+//   --fixed-cost US  Ignore real time.  Instead, charge exactly US simulated
+//                    microseconds per frame.  This makes runs deterministic.
+//
+
+#include "../dodecahedron.ino"
+#include "host-support.hpp"
+
+// Per-effect statistics.
+//
+
+struct EffectStats {
+    uint32_t frames;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+static EffectStats effect_stats[ShowList::count];
+
+static void report_effect_stats() {
+    printf("\n%-20s %8s %10s %10s %10s\n", "effect", "frames", "total ms", "mean us", "max us");
+    for (int i = 0; i < ShowList::count; i++) {
+        const EffectStats &stats = effect_stats[i];
+        if (stats.frames == 0) continue;
+        printf("%-20s %8u %10.1f %10.1f %10.1f\n", ShowList::name(i), stats.frames,
+            stats.total_ns / 1e6, stats.total_ns / 1e3 / stats.frames, stats.max_ns / 1e3);
+    }
+}
+
+// Report how fast the wiring lets the LEDs refresh, and how fast the
+// simulation actually ran.
+//
+
+static void report_refresh(long frames) {
+    uint32_t wire_micros = LED_OUTPUT_LENGTH * HOST_NEOPXL8_MICROS_PER_PIXEL + HOST_NEOPXL8_LATCH_MICROS;
+    double seconds = host_clock_micros() / 1e6;
+    printf("\nWiring: %d outputs of %d LEDs, %u us per frame on the wire, at most %u fps.\n",
+        LED_OUTPUTS, LED_OUTPUT_LENGTH, wire_micros, 1000000 / wire_micros);
+    printf("Refresh: %ld frames in %.1f simulated seconds, %.1f fps (FRAME_RATE %d).\n",
+        frames, seconds, frames / seconds, FRAME_RATE);
+}
+
+// Write the current frame in canonical order, as R, G, B.
+//
+
+static void dump_frame(FILE *file) {
+    const uint8_t *pixels = leds.getPixels();
+    uint8_t frame[TOTAL_LEDS * 3];
+    for (int i = 0; i < TOTAL_LEDS; i++) {
+        const uint8_t *p = pixels + led_physical_index(i) * 3;
+        frame[i * 3 + 0] = p[LED_R_OFFSET];
+        frame[i * 3 + 1] = p[LED_G_OFFSET];
+        frame[i * 3 + 2] = p[LED_B_OFFSET];
+    }
+    fwrite(frame, sizeof(frame), 1, file);
+}
+
+int main(int argc, char **argv) {
+    long frames = 10000;
+    uint32_t seed = 1;
+    const char *dump_path = NULL;
+    const char *times_path = NULL;
+    uint32_t fixed_cost = 0;
+    for (int i = 1; i < argc; i++) {
+        bool more = (i + 1 < argc);
+        if (more && strcmp(argv[i], "--frames") == 0) {
+            frames = atol(argv[++i]);
+        } else if (more && strcmp(argv[i], "--seed") == 0) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (more && strcmp(argv[i], "--dump") == 0) {
+            dump_path = argv[++i];
+        } else if (more && strcmp(argv[i], "--times") == 0) {
+            times_path = argv[++i];
+        } else if (more && strcmp(argv[i], "--fixed-cost") == 0) {
+            fixed_cost = strtoul(argv[++i], NULL, 0);
+            clock_fixed_cost = true;
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--seed S] [--dump FILE] [--times FILE] [--fixed-cost US]\n", argv[0]);
+            return 1;
+        }
+    }
+    FILE *dump_file = NULL;
+    FILE *times_file = NULL;
+    if (dump_path != NULL) {
+        dump_file = fopen(dump_path, "wb");
+        if (dump_file == NULL) { perror(dump_path); return 1; }
+    }
+    if (times_path != NULL) {
+        times_file = fopen(times_path, "w");
+        if (times_file == NULL) { perror(times_path); return 1; }
+    }
+
+    host_analog_state = seed;
+    setup();
+    for (long frame = 0; frame < frames; frame++) {
+        // loop() may switch shows; charge the frame to the one it rendered.
+        uint32_t show = live_show[current_show].counter;
+        HostClock::time_point start = HostClock::now();
+        loop();
+        HostClock::time_point end = HostClock::now();
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        if (clock_fixed_cost) host_clock_advance(fixed_cost);
+        EffectStats &stats = effect_stats[show];
+        stats.frames++;
+        stats.total_ns += ns;
+        if (ns > stats.max_ns) stats.max_ns = ns;
+        if (times_file != NULL) fprintf(times_file, "%ld %u %.1f\n", frame, show, ns / 1e3);
+        if (dump_file != NULL) dump_frame(dump_file);
+    }
+    report_effect_stats();
+    report_refresh(frames);
+
+    if (dump_file != NULL) fclose(dump_file);
+    if (times_file != NULL) fclose(times_file);
+    return 0;
+}
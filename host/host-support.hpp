@@ -0,0 +1,35 @@
+// Definitions behind the host stand-ins in Arduino.h.  Include this once,
+// from the host program's main source file, after the sketch.
+//
+
+#include <chrono>
+
+HostSerial Serial;
+uint32_t host_random_state = 1;
+uint32_t host_analog_state = 1;
+
+// The mock clock.
+//
+
+typedef std::chrono::steady_clock HostClock;
+
+static HostClock::time_point clock_epoch = HostClock::now();
+static uint64_t clock_offset = 0;
+static bool clock_fixed_cost = false;
+
+uint64_t host_clock_micros() {
+    if (clock_fixed_cost) return clock_offset;
+    HostClock::duration elapsed = HostClock::now() - clock_epoch;
+    return clock_offset + std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void host_clock_advance(uint64_t us) {
+    clock_offset += us;
+}
+
+uint32_t host_cycle_count() {
+    HostClock::duration elapsed = HostClock::now() - clock_epoch;
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    ns += clock_offset * 1000;
+    return uint32_t(ns * (F_CPU / 1000000) / 1000);
+}
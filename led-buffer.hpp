@@ -8,22 +8,494 @@
 #define TOTAL_EDGES (EDGES_PER_STRAND*TOTAL_STRANDS)
 #define TOTAL_LEDS (TOTAL_EDGES*LEDS_PER_EDGE)
 
+// Physical wiring.
+//
+// Effects address the LEDs in canonical order: edge by edge, in the
+// order of dodecahedron_edge[], LEDS_PER_EDGE LEDs per edge.  The
+// physical wiring doesn't have to match.  Each NeoPXL8 output drives a
+// chain of up to LED_EDGES_PER_OUTPUT edges, and led_output_map lists
+// the edges of each chain in the order that the data flows through
+// them.  An edge can be wired in reverse, and a slot can be empty (-1).
+// The output stage applies the map as it converts the frame, so effects
+// never see it.
+//
+// The time to send a frame is set by the length of the longest chain.
+// The original wiring uses 5 outputs of 6 edges, which takes about 5.7
+// ms per frame.  Rewiring into 8 chains of 4 edges or fewer takes about
+// 3.9 ms, so the LEDs can refresh faster.  Set LED_OUTPUTS to match the
+// wiring.
+//
+
+#ifndef LED_OUTPUTS
+#define LED_OUTPUTS 5
+#endif
+
+struct LedChainEdge {
+    int8_t edge;
+    bool reversed;
+};
+
+#if LED_OUTPUTS == 5
+
+// The original wiring: each output drives one strand.
+#define LED_EDGES_PER_OUTPUT 6
+constexpr LedChainEdge led_output_map[LED_OUTPUTS][LED_EDGES_PER_OUTPUT] = {
+    { { 0, false}, { 1, false}, { 2, false}, { 3, false}, { 4, false}, { 5, false} },
+    { { 6, false}, { 7, false}, { 8, false}, { 9, false}, {10, false}, {11, false} },
+    { {12, false}, {13, false}, {14, false}, {15, false}, {16, false}, {17, false} },
+    { {18, false}, {19, false}, {20, false}, {21, false}, {22, false}, {23, false} },
+    { {24, false}, {25, false}, {26, false}, {27, false}, {28, false}, {29, false} },
+};
+
+#elif LED_OUTPUTS == 8
+
+// Eight shorter chains: six of four edges, and two of three.
+#define LED_EDGES_PER_OUTPUT 4
+constexpr LedChainEdge led_output_map[LED_OUTPUTS][LED_EDGES_PER_OUTPUT] = {
+    { { 0, false}, { 1, false}, { 2, false}, { 3, false} },
+    { { 4, false}, { 5, false}, { 6, false}, { 7, false} },
+    { { 8, false}, { 9, false}, {10, false}, {11, false} },
+    { {12, false}, {13, false}, {14, false}, {15, false} },
+    { {16, false}, {17, false}, {18, false}, {19, false} },
+    { {20, false}, {21, false}, {22, false}, {23, false} },
+    { {24, false}, {25, false}, {26, false}, {-1, false} },
+    { {27, false}, {28, false}, {29, false}, {-1, false} },
+};
+
+#else
+#error "There is no wiring map for this number of outputs."
+#endif
+
+#define LED_OUTPUT_LENGTH (LED_EDGES_PER_OUTPUT * LEDS_PER_EDGE)
+
+// Check that the map has every edge exactly once.
+
+constexpr bool led_output_map_valid() {
+    int seen[TOTAL_EDGES] = {};
+    for (int out = 0; out < LED_OUTPUTS; out++) {
+        for (int slot = 0; slot < LED_EDGES_PER_OUTPUT; slot++) {
+            int edge = led_output_map[out][slot].edge;
+            if (edge >= TOTAL_EDGES) return false;
+            if (edge >= 0) seen[edge]++;
+        }
+    }
+    for (int edge = 0; edge < TOTAL_EDGES; edge++) {
+        if (seen[edge] != 1) return false;
+    }
+    return true;
+}
+
+static_assert(LED_OUTPUTS <= 8, "NeoPXL8 has eight outputs.");
+static_assert(led_output_map_valid(), "led_output_map must list every edge exactly once.");
+
+// led_physical_index
+//
+// Find where an LED is in the driver's pixel buffer.  This searches the
+// map, so it's for tools and diagnostics, not for rendering.
+
+int led_physical_index(int led) {
+    int edge = led / LEDS_PER_EDGE;
+    int offset = led % LEDS_PER_EDGE;
+    for (int out = 0; out < LED_OUTPUTS; out++) {
+        for (int slot = 0; slot < LED_EDGES_PER_OUTPUT; slot++) {
+            const LedChainEdge &chain = led_output_map[out][slot];
+            if (chain.edge != edge) continue;
+            if (chain.reversed) offset = LEDS_PER_EDGE - 1 - offset;
+            return (out * LED_OUTPUT_LENGTH) + (slot * LEDS_PER_EDGE) + offset;
+        }
+    }
+    return -1;
+}
+
 // NeoPXL8 declaration.
 //
 
 int8_t neopxl8_pins[8] = { 0, 1, 7, 9, 10, 11, 12, 13 };
 const uint32_t NEOPXL8_CHANNELS = NEO_BGR; // Use for GS8208
 // const uint32_t NEOPXL8_CHANNELS = NEO_GRB; // Use for WS2818b
-Adafruit_NeoPXL8 leds(LEDS_PER_STRAND, neopxl8_pins, NEOPXL8_CHANNELS);
+Adafruit_NeoPXL8 leds(LED_OUTPUT_LENGTH, neopxl8_pins, NEOPXL8_CHANNELS);
+
+// Double buffering.
+//
+// The output stage converts the render frame into the NeoPXL8 pixel
+// buffer, which serves as the back buffer.  The driver converts the pixel buffer into a DMA buffer and
+// transmits from there, so the DMA buffer is the front buffer.  In double
+// buffered mode, the driver allocates two DMA buffers, which makes it
+// possible to convert frame N+1 while frame N is still going out over
+// the wire.
+//
+// The swap only waits when the previous transfer hasn't finished yet.
+// It keeps track of how long it waited, how long the driver spent
+// staging the pixels into the DMA buffer, and how long the effect spent
+// rendering between swaps.  Only the two spin loops count as waiting,
+// so if an effect rarely waits, it's compute bound.  If it waits often,
+// it's wire bound.
+//
+
+#define LED_DOUBLE_BUFFER true
+
+struct LedSwapStats {
+    uint32_t swaps;
+    uint32_t waited_swaps;
+    uint32_t wait_micros;
+    uint32_t stage_micros;
+    uint32_t render_micros;
+    uint32_t render_start;
+
+    void reset() {
+        swaps = 0;
+        waited_swaps = 0;
+        wait_micros = 0;
+        stage_micros = 0;
+        render_micros = 0;
+    }
+
+    void report() const {
+        Serial.printf("Swap: %d swaps, %d waited, %d ms waiting, %d ms staging, %d ms rendering.\n",
+            int(swaps), int(waited_swaps), int(wait_micros / 1000), int(stage_micros / 1000),
+            int(render_micros / 1000));
+    }
+};
+
+LedSwapStats led_swap_stats;
+
+// Call this before rendering into the back buffer.
+
+void led_begin_frame() {
+    led_swap_stats.render_start = micros();
+}
+
+// Hand the back buffer over to the driver, and start transmitting it.
+
+void led_swap() {
+    uint32_t start = micros();
+    while (!leds.canStage()) {}
+    uint32_t staging = micros();
+    leds.stage();
+    uint32_t staged = micros();
+    while (!leds.canShow()) {}
+    uint32_t ready = micros();
+    leds.show();
+    uint32_t waited = (staging - start) + (ready - staged);
+    LedSwapStats &stats = led_swap_stats;
+    stats.swaps++;
+    if (waited > 0) stats.waited_swaps++;
+    stats.wait_micros += waited;
+    stats.stage_micros += staged - staging;
+    stats.render_micros += start - stats.render_start;
+}
+
+// The render frame.
+//
+// Effects render into led_frame, one RGB color per LED, at full
+// fixed-point precision.  At the end of the frame, led_output converts
+// the frame into the driver's pixel buffer, limiting the power as it
+// goes.  An effect must repaint every LED, every frame.  During a
+// cross-fade, both live shows render into led_frame, one after the
+// other, so what's left in it belongs to the other show.  There are no
+// bounds checks: the caller must stay within TOTAL_LEDS.
+//
+
+RGB led_frame[TOTAL_LEDS];
+
+inline void led_write(int i, const RGB &color) {
+    led_frame[i] = color;
+}
+
+// Write a run of consecutive LEDs, starting at 'first'.
+
+void led_write_span(int first, const RGB *colors, int count) {
+    memcpy(led_frame + first, colors, count * sizeof(RGB));
+}
+
+// Colors that were already packed as neocolors, 8 bits per channel, as
+// from neocolor_unsafe, are unpacked into the frame, so they still go
+// through gamma, dithering and the power limit.  A byte unpacks to the
+// smallest fixed that neocolor_unsafe packs back to the same byte.
 
+inline fixed led_unpack_channel(uint32_t b) {
+    return (b << 7) + (b != 0);
+}
+
+inline RGB led_unpack(uint32_t neocolor) {
+    return RGB(led_unpack_channel((neocolor >> 16) & 0xFF),
+               led_unpack_channel((neocolor >> 8) & 0xFF),
+               led_unpack_channel(neocolor & 0xFF));
+}
+
+inline void led_write(int i, uint32_t neocolor) {
+    led_frame[i] = led_unpack(neocolor);
+}
+
+void led_write_span(int first, const uint32_t *neocolors, int count) {
+    RGB *p = led_frame + first;
+    for (int i = 0; i < count; i++) {
+        p[i] = led_unpack(neocolors[i]);
+    }
+}
+
+template <typename Color>
+void led_write_edge(int edge, const Color *colors) {
+    led_write_span(edge * LEDS_PER_EDGE, colors, LEDS_PER_EDGE);
+}
+
+template <typename Color>
+void led_write_strand(int strand, const Color *colors) {
+    led_write_span(strand * LEDS_PER_STRAND, colors, LEDS_PER_STRAND);
+}
+
+template <typename Color>
+void led_write_frame(const Color *colors) {
+    led_write_span(0, colors, TOTAL_LEDS);
+}
+
+// Set a run of consecutive LEDs to one color.
+
+void led_fill(int first, int count, const RGB &color) {
+    RGB *p = led_frame + first;
+    for (int i = 0; i < count; i++) {
+        p[i] = color;
+    }
+}
+
+void led_fill(int first, int count, uint32_t neocolor) {
+    led_fill(first, count, led_unpack(neocolor));
+}
+
+// Copy a run of LEDs that were already written to another place in
+// the frame.  The runs must not overlap.
+
+void led_copy_span(int dst, int src, int count) {
+    memcpy(led_frame + dst, led_frame + src, count * sizeof(RGB));
+}
 
 // Just clear all the LEDS to black.
 //
 
 void clear_leds() {
-    for (int i = 0; i < TOTAL_LEDS; i++) {
-        leds.setPixelColor(i, 0);
+    led_fill(0, TOTAL_LEDS, RGB(0, 0, 0));
+}
+
+// Cross-fading.
+//
+// To blend two effects, render the first effect, save the frame,
+// render the second effect, and then blend the saved frame back in.
+// The blend weight 't' is the weight of the second effect.
+//
+
+void led_save(RGB *frame) {
+    memcpy(frame, led_frame, sizeof(led_frame));
+}
+
+void led_blend(const RGB *frame, fixed t) {
+    rgb_lerp_span(led_frame, frame, led_frame, t, TOTAL_LEDS);
+}
+
+// Power limiting.
+//
+// The circuitry driving each output overheats above 1/2 brightness, and
+// each output has its own fuse.  Rather than trusting every effect to
+// stay dim, the output stage adds up R+G+B over each output, and if the
+// output would draw more than its budget, it scales the whole chain
+// down just enough to fit.
+//
+// Power is measured in fixed-point units: an LED with R+G+B = FIXMAX
+// is at 1/3 brightness.  LED_POWER_BUDGET is the sustained limit per
+// LED, averaged over a full chain, and LED_POWER_BURST is the limit that
+// must never be exceeded.  In between, a leaky bucket models the
+// heating of the driver: each output earns credit while it runs under
+// budget, and spends it to run above budget.  A frame can only spend
+// the credit that's in the bucket, so the long-run average never
+// exceeds the budget.  A full bucket allows LED_POWER_BURST_FRAMES
+// frames at the burst limit.
+//
+// The power is measured after gamma correction, on the levels the
+// driver will actually send.  The scaling is folded into the output
+// conversion, so limiting costs one divide per output, not per LED.
+//
+
+#define LED_POWER_BUDGET FIXMAX
+#define LED_POWER_BURST (FIXMAX * 3 / 2)
+#define LED_POWER_BURST_FRAMES 60
+
+#define LED_OUTPUT_BUDGET (LED_POWER_BUDGET * LED_OUTPUT_LENGTH)
+#define LED_OUTPUT_BURST (LED_POWER_BURST * LED_OUTPUT_LENGTH)
+#define LED_OUTPUT_CREDIT (int32_t(LED_OUTPUT_BURST - LED_OUTPUT_BUDGET) * LED_POWER_BURST_FRAMES)
+
+static_assert(LED_POWER_BUDGET <= LED_POWER_BURST, "The power budget must not exceed the burst limit.");
+static_assert(LED_POWER_BURST <= FIXMAX * 3 / 2, "Above 1/2 brightness, the drivers overheat.");
+
+struct LedPowerStats {
+    uint32_t frames;
+    uint32_t burst_frames;
+    uint32_t limited_frames;
+    uint64_t total_power;
+    uint32_t peak_demand;
+    fixed min_scale;
+
+    void reset() {
+        frames = 0;
+        burst_frames = 0;
+        limited_frames = 0;
+        total_power = 0;
+        peak_demand = 0;
+        min_scale = FIXMAX;
+    }
+};
+
+struct LedOutputPower {
+    int32_t credit;
+    LedPowerStats stats;
+};
+
+LedOutputPower led_power[LED_OUTPUTS];
+
+// Channel offsets within each pixel, from the compile-time color order.
+
+const int LED_R_OFFSET = (NEOPXL8_CHANNELS >> 4) & 3;
+const int LED_G_OFFSET = (NEOPXL8_CHANNELS >> 2) & 3;
+const int LED_B_OFFSET = NEOPXL8_CHANNELS & 3;
+
+static_assert((LED_R_OFFSET != LED_G_OFFSET) && (LED_G_OFFSET != LED_B_OFFSET) &&
+              (LED_B_OFFSET != LED_R_OFFSET) && (LED_R_OFFSET + LED_G_OFFSET + LED_B_OFFSET == 3),
+              "NEOPXL8_CHANNELS must be a three-channel color order.");
+
+// led_output_scale
+//
+// Decide how much to scale an output that wants 'demand' units of power,
+// and update its thermal credit.  'steps' is the number of frame periods
+// that this frame lasts.
+
+fixed led_output_scale(LedOutputPower &power, uint32_t demand, uint32_t steps) {
+    uint32_t allowed = min(uint32_t(LED_OUTPUT_BURST), uint32_t(LED_OUTPUT_BUDGET + power.credit / int32_t(steps)));
+    uint32_t output = min(demand, allowed);
+    fixed scale = FIXMAX;
+    if (demand > allowed) {
+        scale = (uint64_t(allowed) << 15) / demand;
     }
+    // The credit can't go negative, since the overdraw is at most
+    // credit / steps per step.  The change is figured in 64 bits, since
+    // the budget times a long stall overflows an int32.
+    int64_t credit = power.credit + (int64_t(LED_OUTPUT_BUDGET) - int64_t(output)) * steps;
+    power.credit = min(credit, int64_t(LED_OUTPUT_CREDIT));
+
+    LedPowerStats &stats = power.stats;
+    stats.frames++;
+    if (output > LED_OUTPUT_BUDGET) stats.burst_frames++;
+    if (scale < FIXMAX) stats.limited_frames++;
+    stats.total_power += output;
+    stats.peak_demand = max(stats.peak_demand, demand);
+    stats.min_scale = min(stats.min_scale, scale);
+    return scale;
+}
+
+// Output conversion.
+//
+// Each channel goes through the gamma table, which yields an 8.8 level.
+// The high byte is sent to the LED.  The low byte is added to a per-LED
+// error accumulator, and when the accumulator overflows, the LED is sent
+// one level higher.  Over several frames, the LED averages out to the
+// full-precision level, which makes slow fades and dim colors smooth.
+// Dithering is only invisible when the refresh rate is high: a dim LED
+// that's one level up on some frames and not others flickers at a
+// fraction of the frame rate.  Below LED_DITHER_MIN_RATE frames per
+// second, the levels are rounded instead.  Either way, this has to be
+// cheap: per channel, it's a table lookup, a multiply for the power
+// scaling, and an add.
+//
+// The conversion for each output takes two passes.  The first follows
+// the wiring map, looks up the levels in the driver's channel order,
+// and adds them up.  The second scales them, dithers them, and stores
+// them in the driver's pixel buffer.
+//
+
+#ifndef LED_DITHER_MIN_RATE
+#define LED_DITHER_MIN_RATE 100
+#endif
+
+#define LED_DITHER (FRAME_RATE >= LED_DITHER_MIN_RATE)
+
+uint16_t led_levels[LED_OUTPUT_LENGTH * 3];
+uint8_t led_dither[LED_OUTPUTS * LED_OUTPUT_LENGTH * 3];
+
+// led_output
+//
+// Convert the frame into the driver's pixel buffer, applying the wiring
+// map, gamma, power limiting and dithering.  'steps' is the number of
+// frame periods since the last call.
+
+void led_output(uint32_t steps) {
+    uint8_t *pixels = leds.getPixels();
+    for (int out = 0; out < LED_OUTPUTS; out++) {
+        uint32_t sum = 0;
+        uint16_t *level = led_levels;
+        for (int slot = 0; slot < LED_EDGES_PER_OUTPUT; slot++) {
+            const LedChainEdge &chain = led_output_map[out][slot];
+            if (chain.edge < 0) {
+                memset(level, 0, LEDS_PER_EDGE * 3 * sizeof(uint16_t));
+                level += LEDS_PER_EDGE * 3;
+                continue;
+            }
+            const RGB *src = led_frame + chain.edge * LEDS_PER_EDGE;
+            int step = 1;
+            if (chain.reversed) {
+                src += LEDS_PER_EDGE - 1;
+                step = -1;
+            }
+            for (int i = 0; i < LEDS_PER_EDGE; i++, src += step, level += 3) {
+                uint32_t r = gamma_lookup(src->R);
+                uint32_t g = gamma_lookup(src->G);
+                uint32_t b = gamma_lookup(src->B);
+                level[LED_R_OFFSET] = r;
+                level[LED_G_OFFSET] = g;
+                level[LED_B_OFFSET] = b;
+                sum += r + g + b;
+            }
+        }
+        uint32_t demand = (uint64_t(sum) << 15) / LED_GAMMA_MAX;
+        uint32_t scale = led_output_scale(led_power[out], demand, steps);
+        int base = out * LED_OUTPUT_LENGTH * 3;
+        uint8_t *p = pixels + base;
+        if (!LED_DITHER) {
+            for (int i = 0; i < LED_OUTPUT_LENGTH * 3; i++) {
+                p[i] = (((led_levels[i] * scale) >> 15) + 0x80) >> 8;
+            }
+            continue;
+        }
+        uint8_t *err = led_dither + base;
+        for (int i = 0; i < LED_OUTPUT_LENGTH * 3; i++) {
+            uint32_t v = ((led_levels[i] * scale) >> 15) + err[i];
+            p[i] = v >> 8;
+            err[i] = v;
+        }
+    }
+}
+
+void led_power_reset() {
+    for (int out = 0; out < LED_OUTPUTS; out++) {
+        led_power[out].stats.reset();
+    }
+}
+
+// Print the power telemetry, as a percentage of the budget.
+
+void led_power_report() {
+    for (int out = 0; out < LED_OUTPUTS; out++) {
+        const LedPowerStats &stats = led_power[out].stats;
+        if (stats.frames == 0) continue;
+        uint32_t mean = stats.total_power * 100 / stats.frames / LED_OUTPUT_BUDGET;
+        uint32_t peak = uint64_t(stats.peak_demand) * 100 / LED_OUTPUT_BUDGET;
+        Serial.printf("Power: output %d, mean %d%%, peak demand %d%%, %d burst frames, %d limited frames, min scale %d%%.\n",
+            out, int(mean), int(peak), int(stats.burst_frames), int(stats.limited_frames),
+            int(uint32_t(stats.min_scale) * 100 / FIXMAX));
+    }
+}
+
+void led_begin() {
+    leds.begin(LED_DOUBLE_BUFFER);
+    leds.setBrightness(255);
+    led_swap_stats.reset();
+    led_power_reset();
 }
 
 // Get offsets of pixels.
@@ -31,27 +503,27 @@ void clear_leds() {
 // These allow you to find the index of an LED given its coordinates.
 //
 
-int strand_edge_forward(int strand, int edge, int offset) {
+constexpr int strand_edge_forward(int strand, int edge, int offset) {
     return (strand * LEDS_PER_STRAND) + (edge * LEDS_PER_EDGE) + offset;
 }
 
-int strand_edge_backward(int strand, int edge, int offset) {
+constexpr int strand_edge_backward(int strand, int edge, int offset) {
     return (strand * LEDS_PER_STRAND) + (edge * LEDS_PER_EDGE) + (LEDS_PER_EDGE - offset - 1);
 }
 
-int strand_edge_middle_backward(int strand, int edge, int offset) {
+constexpr int strand_edge_middle_backward(int strand, int edge, int offset) {
     return (strand * LEDS_PER_STRAND) + (edge * LEDS_PER_EDGE) + (LEDS_PER_HALF - offset - 1);
 }
 
-int strand_edge_middle_forward(int strand, int edge, int offset) {
+constexpr int strand_edge_middle_forward(int strand, int edge, int offset) {
     return (strand * LEDS_PER_STRAND) + (edge * LEDS_PER_EDGE) + (LEDS_PER_HALF + offset);
 }
 
-int edge_forward(int edge, int offset) {
+constexpr int edge_forward(int edge, int offset) {
     return (edge * LEDS_PER_EDGE) + offset;
 }
 
-int edge_backward(int edge, int offset) {
+constexpr int edge_backward(int edge, int offset) {
     return (edge * LEDS_PER_EDGE) + (LEDS_PER_EDGE - offset - 1);
 }
 
@@ -64,65 +536,3 @@ int mainchain_forward(int strand, int offset) {
 int mainchain_backward(int strand, int offset) {
     return (strand * LEDS_PER_STRAND) + (MAINCHAIN_LENGTH - offset - 1);
 }        
-
-// Store colors on the "waterfall" that goes from the top to the bottom.
-//
-// The following routine treats the dodecahedron as if it were a
-// single line of pixels, running from the top to the bottom of the
-// dodecahedron.  In reality, the "line" starts in the middle of every
-// top-edge, and it works its way down to the middle of every bottom
-// edge.
-//
-
-const int SPC_WATERFALL_LENGTH (LEDS_PER_HALF * 8);
-
-void spc_waterfall(int i, uint32_t neocolor) {
-    for (int strand = 0; strand < TOTAL_STRANDS; strand++) {
-        int segment = i / LEDS_PER_HALF;
-        int offset = i - (segment * LEDS_PER_HALF);
-        switch (segment) {
-        case 0:
-            leds.setPixelColor(strand_edge_middle_forward(strand, 0, offset), neocolor);
-            leds.setPixelColor(strand_edge_middle_backward(strand, 0, offset), neocolor);
-            break;
-        case 1:
-            leds.setPixelColor(strand_edge_forward(strand, 1, offset), neocolor);
-            break;
-        case 2:
-            leds.setPixelColor(strand_edge_middle_forward(strand, 1, offset), neocolor);
-            break;
-        case 3:
-            leds.setPixelColor(strand_edge_forward(strand, 2, offset), neocolor);
-            leds.setPixelColor(strand_edge_backward(strand, 5, offset), neocolor);
-            break;
-        case 4:
-            leds.setPixelColor(strand_edge_middle_forward(strand, 2, offset), neocolor);
-            leds.setPixelColor(strand_edge_middle_backward(strand, 5, offset), neocolor);
-            break;
-        case 5:
-            leds.setPixelColor(strand_edge_forward(strand, 3, offset), neocolor);
-            break;
-        case 6:
-            leds.setPixelColor(strand_edge_middle_forward(strand, 3, offset), neocolor);
-            break;
-        case 7:
-            leds.setPixelColor(strand_edge_forward(strand, 4, offset), neocolor);
-            leds.setPixelColor(strand_edge_backward(strand, 4, offset), neocolor);
-            break;
-        }
-    }
-}
-
-// A tool to store the same values in all edges.
-//
-struct EdgeData {
-    uint32_t data[LEDS_PER_EDGE];
-    
-    void write_all() {
-        for (int i = 0; i < TOTAL_EDGES; i++) {
-            for (int j = 0; j < LEDS_PER_EDGE; j++) {
-                leds.setPixelColor(j + i * LEDS_PER_EDGE, data[j]);
-            }
-        }
-    }
-};
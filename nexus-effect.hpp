@@ -1,6 +1,29 @@
 #define NEXUS_CLASSES 3
 #define NEXUS_PHASES 8
 
+// Spots are converted to RGB in batches of this many.
+#define NEXUS_BATCH 32
+
+// The brightness and saturation of a spot, as it goes through its
+// stages.  It fades in and out slowly, with a whitish flash at the peak.
+// The glow goes up to 5/4 FIXMAX, and the brightness clips it.
+
+constexpr fixed nexus_spot_glow(fixed stage) {
+    uint32_t ramp0 = a_ramp(stage, 0);
+    uint32_t ramp1 = a_ramp(stage, 1);
+    uint32_t pulse2 = fixed_sqr(fixed_sqr(a_ramp(stage, 2)));
+    return (ramp0>>3) + (ramp1>>3) + pulse2;
+}
+
+constexpr fixed nexus_spot_brightness(fixed stage) {
+    return fixed_clamp(nexus_spot_glow(stage));
+}
+
+constexpr fixed nexus_spot_saturation(fixed stage) {
+    uint32_t pulse1 = fixed_sqr(a_ramp(stage, 2));
+    return fixed_clamp(FIXMAX - (pulse1 * 2 / 3));
+}
+
 struct NexusSpot {
     int class_index;
     int stage;
@@ -20,11 +43,14 @@ struct NexusEffect {
     int phase_color_[NEXUS_PHASES];
     int phase_intensity_[NEXUS_PHASES];
     int phase_speed_[NEXUS_PHASES];
+    Prng rng_;
+
+    static const char *name() { return "NexusEffect"; }
     
     void initialize_show() {
         for (int i = 0; i < NEXUS_CLASSES; i++) {
             NexusClass &cls = classes_[i];
-            cls.hue = random(FIXMAX);
+            cls.hue = rng_.below(FIXMAX);
             for (int i = 0; i < 7; i++) {
                 cls.quantity[i] = FIXMAX;
             }
@@ -44,16 +70,16 @@ struct NexusEffect {
             for (int j = 0; j < NEXUS_CLASSES; j++) {
                 classes_[j].quantity[i] = FIXMAX/20;
             }
-            switch(random(2)) {
+            switch(rng_.below(2)) {
                 case 0: break;
                 case 1: phase_intensity_[i] /= 2; break;
                 case 2: phase_intensity_[i] /= 4; break;
             }
-            phase_color_[i] = random(NEXUS_CLASSES);
+            phase_color_[i] = rng_.below(NEXUS_CLASSES);
             classes_[phase_color_[i]].quantity[i] = FIXMAX;
-            int speed_multiplier = random(100) + 50;
+            int speed_multiplier = rng_.below(100) + 50;
             phase_speed_[i] = fixed_lerp_fast(30, 100, phase_intensity_[i]);
-            switch(random(2)) {
+            switch(rng_.below(2)) {
                 case 0: break;
                 case 1: phase_speed_[i] /= 2; break;
                 case 2: phase_speed_[i] = phase_speed_[i] * 3 / 2; break;
@@ -69,12 +95,13 @@ struct NexusEffect {
     }
 
     NexusEffect() {
+        rng_ = prng_new_stream();
         initialize_show();
     }
     
     int pick_inactive_spot() {
         while (true) {
-            int index = random(TOTAL_LEDS);
+            int index = rng_.below(TOTAL_LEDS);
             if (spots_[index].speed == 0) {
                 return index;
             }
@@ -123,13 +150,13 @@ struct NexusEffect {
             // Pick a random spot, and offer it to each class in turn.
             int spot_index = pick_inactive_spot();
             NexusSpot &spot = spots_[spot_index];
-            int class_base = random(NEXUS_CLASSES);
+            int class_base = rng_.below(NEXUS_CLASSES);
             for (int class_offset = 0; class_offset < NEXUS_CLASSES; class_offset++) {
                 int class_index = (class_base + class_offset) % NEXUS_CLASSES;
                 NexusClass &cls = classes_[class_index];
                 if (cls.active >= cls.desire) continue;
                 spot.class_index = class_index;
-                spot.speed = speed + random(speed);
+                spot.speed = speed + rng_.below(speed);
                 spot.stage = 0;
                 cls.active += 1;
                 break;
@@ -143,21 +170,29 @@ struct NexusEffect {
         int age = fixed_clamp(show_age * 2);
         start_new_spots(age);
         clear_leds();
+        uint16_t index[NEXUS_BATCH];
+        fixed hue[NEXUS_BATCH];
+        fixed sat[NEXUS_BATCH];
+        fixed bright[NEXUS_BATCH];
+        RGB rgb[NEXUS_BATCH];
+        int batch = 0;
         for (int i = 0; i < TOTAL_LEDS; i++) {
             NexusSpot &spot = spots_[i];
-            if (spot.speed == 0) continue;
-            uint32_t ramp0 = a_ramp(spot.stage, 0);
-            uint32_t ramp1 = a_ramp(spot.stage, 1);
-            uint32_t ramp2 = a_ramp(spot.stage, 2);
-            uint32_t pulse1 = fixed_sqr(ramp2);
-            uint32_t pulse2 = fixed_sqr(pulse1);
-            uint32_t bright = fixed_clamp((ramp0>>3) + (ramp1>>3) + pulse2);
-            fixed sat = fixed_clamp(FIXMAX - (pulse1 * 2 / 3));
-            fixed hue = classes_[spot.class_index].hue;
-            RGB rgb = hue_sat(hue, sat).brighten().scale(bright);
-            uint32_t neocolor = rgb.neocolor_unsafe();
-            leds.setPixelColor(i, neocolor);
-            spot.stage += spot.speed;
+            if (spot.speed != 0) {
+                index[batch] = i;
+                bright[batch] = nexus_spot_brightness(spot.stage);
+                sat[batch] = nexus_spot_saturation(spot.stage);
+                hue[batch] = classes_[spot.class_index].hue;
+                batch++;
+                spot.stage += spot.speed * frame_steps;
+            }
+            if ((batch == NEXUS_BATCH) || ((i == TOTAL_LEDS - 1) && (batch > 0))) {
+                hsv_bright_span(rgb, hue, sat, bright, batch);
+                for (int b = 0; b < batch; b++) {
+                    led_write(index[b], rgb[b]);
+                }
+                batch = 0;
+            }
         }
         kill_finished_spots();
         
@@ -0,0 +1,183 @@
+// Particles
+//
+// Comets and cars are particles: lights that travel along the edges.
+// Particles<N> holds up to N of them, with each field in its own array,
+// indexed by slot.  The common fields are here: the directed edge, the
+// position along it, the speed, and the turns to take at the next few
+// vertices.  An effect that needs more fields, such as a hue, keeps its
+// own arrays of N, indexed by the same slots.
+//
+// The live particles are listed densely, so a pass over them costs the
+// number that are live, not N.  live() is the count, and slot(i) is the
+// slot of the i-th.  Spawning pops a slot from a stack of free slots,
+// and killing the i-th live particle moves the last one into its place,
+// so both are O(1).  Killing reorders the list, so a loop that kills
+// should not advance i past a kill.
+//
+// A particle can be spawned with a delay, in frame periods.  It waits in
+// a timing wheel, a ring of PARTICLE_WHEEL lists keyed by the tick it's
+// due, and release moves it to the live list when the clock reaches that
+// tick.  Each tick drains one list, so waiting particles cost nothing
+// per frame.  A delay longer than the wheel is fine: the particle stays
+// in its list when the wheel comes around early.
+//
+// Each frame, the effect should call release, then draw and advance the
+// live particles, then call tick with frame_steps.
+//
+
+#define PARTICLE_WHEEL 256
+#define NO_PARTICLE 0xFFFF
+
+template <int Capacity>
+class Particles {
+public:
+    PackedEdge edge[Capacity];
+    int32_t position[Capacity];
+    uint16_t speed[Capacity];
+    uint8_t turns[Capacity]; // Bit 0 is the next turn.  1 is left.
+
+private:
+    uint16_t live_[Capacity];
+    uint16_t free_[Capacity];
+    uint16_t next_[Capacity];
+    uint32_t due_[Capacity];
+    uint16_t wheel_[PARTICLE_WHEEL];
+    int live_count_;
+    int free_count_;
+    int waiting_;
+    uint32_t now_;
+    uint32_t released_;
+
+    void release_bucket(int bucket) {
+        uint16_t *link = &wheel_[bucket];
+        while (*link != NO_PARTICLE) {
+            int s = *link;
+            if (int32_t(due_[s] - now_) > 0) {
+                link = &next_[s];
+                continue;
+            }
+            *link = next_[s];
+            live_[live_count_++] = s;
+            waiting_--;
+        }
+    }
+
+public:
+    Particles() {
+        clear();
+    }
+
+    void clear() {
+        for (int s = 0; s < Capacity; s++) {
+            free_[s] = Capacity - 1 - s;
+        }
+        for (int b = 0; b < PARTICLE_WHEEL; b++) {
+            wheel_[b] = NO_PARTICLE;
+        }
+        live_count_ = 0;
+        free_count_ = Capacity;
+        waiting_ = 0;
+        now_ = 0;
+        released_ = 0;
+    }
+
+    // The number of live particles, and the number live or waiting.
+
+    int live() const {
+        return live_count_;
+    }
+
+    int size() const {
+        return live_count_ + waiting_;
+    }
+
+    bool full() const {
+        return free_count_ == 0;
+    }
+
+    int slot(int i) const {
+        return live_[i];
+    }
+
+    DirectedEdge directed_edge(int s) const {
+        return DirectedEdge::unpack(edge[s]);
+    }
+
+    // spawn
+    //
+    // Returns the slot of a new particle, which goes live after delay
+    // ticks, or right away if the delay is 0.  The caller fills in the
+    // fields.  The caller must check that the particles aren't full.
+
+    int spawn(uint32_t delay = 0) {
+        int s = free_[--free_count_];
+        if (delay == 0) {
+            live_[live_count_++] = s;
+            return s;
+        }
+        due_[s] = now_ + delay;
+        int bucket = due_[s] & (PARTICLE_WHEEL - 1);
+        next_[s] = wheel_[bucket];
+        wheel_[bucket] = s;
+        waiting_++;
+        return s;
+    }
+
+    // kill
+    //
+    // Free the i-th live particle.  The last live particle takes its
+    // place in the list.
+
+    void kill(int i) {
+        int s = live_[i];
+        live_[i] = live_[--live_count_];
+        free_[free_count_++] = s;
+    }
+
+    // release
+    //
+    // Make the waiting particles that are due live.
+
+    void release() {
+        uint32_t ticks = now_ - released_;
+        if (ticks > PARTICLE_WHEEL) ticks = PARTICLE_WHEEL;
+        for (uint32_t k = 0; k < ticks; k++) {
+            release_bucket((now_ - k) & (PARTICLE_WHEEL - 1));
+        }
+        released_ = now_;
+    }
+
+    void tick(uint32_t steps) {
+        now_ += steps;
+    }
+
+    // advance
+    //
+    // Move every live particle forward by its speed, times percent / 100,
+    // for the given number of frame periods.
+
+    void advance(uint32_t steps, int percent = 100) {
+        for (int i = 0; i < live_count_; i++) {
+            int s = live_[i];
+            int32_t step = (percent == 100) ? speed[s] : (speed[s] * percent / 100);
+            position[s] += step * int32_t(steps);
+        }
+    }
+
+    // follow_paths
+    //
+    // Move every live particle that has run off the end of its edge
+    // onto the next edge, turning as planned.  Each turn taken is
+    // replaced by a coin toss, lookahead turns ahead.
+
+    void follow_paths(int32_t length, int lookahead, Prng &rng) {
+        for (int i = 0; i < live_count_; i++) {
+            int s = live_[i];
+            while (position[s] >= length) {
+                position[s] -= length;
+                edge[s] = directed_edge(s).successor(turns[s] & 1).pack();
+                turns[s] = (turns[s] >> 1) | (rng.coin() << (lookahead - 1));
+            }
+        }
+    }
+};
@@ -0,0 +1,220 @@
+// Pixel Kernels
+//
+// Loops over whole arrays of RGB, for the per-LED passes that dominate
+// some effects.  An array of RGB is just a run of 16-bit channels, R G B
+// R G B ..., and the add, subtract and max operations treat each channel
+// the same way, so the kernels process the run two channels at a time,
+// as pairs packed into 32-bit words.
+//
+// On the Cortex-M4, the pairs can go through the DSP extension's dual
+// 16-bit instructions: UQADD16 and UQSUB16 do two saturating adds or
+// subtracts at once, and USUB16 followed by SEL does two compares and
+// selects.  Elsewhere, the same pair operations are written out in
+// plain C.  Both are meant to produce exactly the same results as the
+// RGB methods (add, sub, maxv, scale, lerp) applied pixel by pixel, and
+// check_pixel_kernels in bench.hpp checks this.
+//
+// The DSP path is off unless PIXEL_KERNELS_SIMD is defined as 1, since
+// it hasn't been run on the target yet.  To turn it on, build with
+// BENCHMARK and PIXEL_KERNELS_SIMD, check that check_pixel_kernels
+// reports no mismatches, and compare each span with its loop in the
+// benchmarks.  Only the spans that come out ahead there should replace
+// per-pixel loops in the effects.
+//
+// Scale and lerp need 16x16 multiplies whose inputs can be FIXMAX,
+// which doesn't fit the signed dual multiplies, so they multiply one
+// channel at a time.  They still save the per-pixel call overhead.
+//
+
+#ifndef PIXEL_KERNELS_SIMD
+#define PIXEL_KERNELS_SIMD 0
+#endif
+
+#if PIXEL_KERNELS_SIMD && !(defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1))
+#error "PIXEL_KERNELS_SIMD needs the Cortex-M4 DSP extension."
+#endif
+
+static_assert(sizeof(RGB) == 3 * sizeof(fixed), "The kernels treat RGB arrays as runs of channels.");
+
+#define PK_FIXMAX_PAIR ((uint32_t(FIXMAX) << 16) | FIXMAX)
+
+inline uint32_t pk_load(const fixed *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void pk_store(fixed *p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+// The pair operations, in plain C.  These are the reference for the DSP
+// versions below, and check_pixel_kernels compares the two.
+
+// Saturating add, each half clamped to 0xFFFF.
+
+inline uint32_t pk_uqadd16_c(uint32_t a, uint32_t b) {
+    uint32_t lo = (a & 0xFFFF) + (b & 0xFFFF);
+    uint32_t hi = (a >> 16) + (b >> 16);
+    if (lo > 0xFFFF) lo = 0xFFFF;
+    if (hi > 0xFFFF) hi = 0xFFFF;
+    return lo | (hi << 16);
+}
+
+// Saturating subtract, each half clamped to 0.
+
+inline uint32_t pk_uqsub16_c(uint32_t a, uint32_t b) {
+    uint32_t lo = (a & 0xFFFF);
+    uint32_t hi = (a >> 16);
+    lo = (lo > (b & 0xFFFF)) ? (lo - (b & 0xFFFF)) : 0;
+    hi = (hi > (b >> 16)) ? (hi - (b >> 16)) : 0;
+    return lo | (hi << 16);
+}
+
+// Unsigned max and min of each half.
+
+inline uint32_t pk_max16_c(uint32_t a, uint32_t b) {
+    uint32_t lo = max(a & 0xFFFF, b & 0xFFFF);
+    uint32_t hi = max(a >> 16, b >> 16);
+    return lo | (hi << 16);
+}
+
+inline uint32_t pk_min16_c(uint32_t a, uint32_t b) {
+    uint32_t lo = min(a & 0xFFFF, b & 0xFFFF);
+    uint32_t hi = min(a >> 16, b >> 16);
+    return lo | (hi << 16);
+}
+
+#if PIXEL_KERNELS_SIMD
+
+inline uint32_t pk_uqadd16(uint32_t a, uint32_t b) {
+    return __UQADD16(a, b);
+}
+
+inline uint32_t pk_uqsub16(uint32_t a, uint32_t b) {
+    return __UQSUB16(a, b);
+}
+
+// USUB16 sets a GE flag for each half where a >= b, and SEL picks each
+// half from its first operand where the flag is set.  The compiler
+// doesn't know that SEL reads the flags, so the two are one asm
+// statement, and nothing can be scheduled between them.
+
+inline uint32_t pk_max16(uint32_t a, uint32_t b) {
+    uint32_t result, difference;
+    __asm__ ("usub16 %1, %2, %3\n\tsel %0, %2, %3"
+        : "=r" (result), "=&r" (difference) : "r" (a), "r" (b) : "cc");
+    return result;
+}
+
+inline uint32_t pk_min16(uint32_t a, uint32_t b) {
+    uint32_t result, difference;
+    __asm__ ("usub16 %1, %2, %3\n\tsel %0, %3, %2"
+        : "=r" (result), "=&r" (difference) : "r" (a), "r" (b) : "cc");
+    return result;
+}
+
+#else
+
+inline uint32_t pk_uqadd16(uint32_t a, uint32_t b) { return pk_uqadd16_c(a, b); }
+inline uint32_t pk_uqsub16(uint32_t a, uint32_t b) { return pk_uqsub16_c(a, b); }
+inline uint32_t pk_max16(uint32_t a, uint32_t b) { return pk_max16_c(a, b); }
+inline uint32_t pk_min16(uint32_t a, uint32_t b) { return pk_min16_c(a, b); }
+
+#endif
+
+// pk_channels
+//
+// Apply a pair operation to 'count' channels, two at a time, with the
+// odd channel at the end padded out to a pair.
+
+template <typename Op>
+inline void pk_channels(fixed *dst, const fixed *src, int count, Op op) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        pk_store(dst + i, op(pk_load(dst + i), pk_load(src + i)));
+    }
+    if (i < count) {
+        dst[i] = op(dst[i], src[i]);
+    }
+}
+
+template <typename Op>
+inline void pk_channels(fixed *dst, int count, Op op) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        pk_store(dst + i, op(pk_load(dst + i)));
+    }
+    if (i < count) {
+        dst[i] = op(dst[i]);
+    }
+}
+
+// rgb_add_span
+//
+// dst[i] = dst[i].add(src[i])
+
+void rgb_add_span(RGB *dst, const RGB *src, int n) {
+    pk_channels(&dst->R, &src->R, n * 3, [](uint32_t a, uint32_t b) {
+        return pk_min16(pk_uqadd16(a, b), PK_FIXMAX_PAIR);
+    });
+}
+
+// rgb_sub_span
+//
+// dst[i] = dst[i].sub(src[i])
+
+void rgb_sub_span(RGB *dst, const RGB *src, int n) {
+    pk_channels(&dst->R, &src->R, n * 3, [](uint32_t a, uint32_t b) {
+        return pk_uqsub16(a, b);
+    });
+}
+
+// rgb_sub_grey_span
+//
+// dst[i] = dst[i].sub(RGB(v, v, v))
+
+void rgb_sub_grey_span(RGB *dst, fixed v, int n) {
+    uint32_t pair = (uint32_t(v) << 16) | v;
+    pk_channels(&dst->R, n * 3, [pair](uint32_t a) {
+        return pk_uqsub16(a, pair);
+    });
+}
+
+// rgb_max_span
+//
+// dst[i] = dst[i].maxv(src[i])
+
+void rgb_max_span(RGB *dst, const RGB *src, int n) {
+    pk_channels(&dst->R, &src->R, n * 3, [](uint32_t a, uint32_t b) {
+        return pk_max16(a, b);
+    });
+}
+
+// rgb_scale_span
+//
+// dst[i] = src[i].scale(f).  dst and src may be the same array.
+
+void rgb_scale_span(RGB *dst, const RGB *src, fixed f, int n) {
+    const fixed *s = &src->R;
+    fixed *d = &dst->R;
+    int32_t fi = f;
+    for (int i = 0; i < n * 3; i++) {
+        d[i] = (int32_t(s[i]) * fi) >> 15;
+    }
+}
+
+// rgb_lerp_span
+//
+// dst[i] = a[i].lerp(b[i], t).  dst may be the same array as a or b.
+
+void rgb_lerp_span(RGB *dst, const RGB *a, const RGB *b, fixed t, int n) {
+    const fixed *pa = &a->R;
+    const fixed *pb = &b->R;
+    fixed *d = &dst->R;
+    int32_t it = t;
+    int32_t iu = FIXMAX - it;
+    for (int i = 0; i < n * 3; i++) {
+        d[i] = (int32_t(pb[i]) * it + int32_t(pa[i]) * iu) >> 15;
+    }
+}
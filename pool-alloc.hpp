@@ -8,8 +8,14 @@
 // can be cleared when switching effects.  I've provided a version of operator
 // new that can take a pool as a parameter.
 //
+// During a transition between shows, two effects are alive at once.
+// So there are two pools, each of which is POOL_ALLOC_SIZE bytes, and
+// that's the most that any one effect can use.
+//
 
-#define POOL_ALLOC_SIZE 65536
+#define POOL_ALLOC_SIZE 32768
+#define POOL_ALLOC_ALIGN 8
+#define POOL_ALLOC_ROUND(nbytes) (((nbytes) + (POOL_ALLOC_ALIGN - 1)) & ~(POOL_ALLOC_ALIGN - 1))
 
 class PoolAlloc {
 private:
@@ -25,7 +31,7 @@ public:
     // aligned for doubles.
     
     unsigned char *alloc(uint32_t nbytes) {
-        nbytes = (nbytes + 7) & (~7);
+        nbytes = POOL_ALLOC_ROUND(nbytes);
         if (used_ + nbytes > POOL_ALLOC_SIZE) {
             Serial.printf("PoolAlloc::alloc failed.\n");
             return NULL;
@@ -0,0 +1,108 @@
+// Fast Random Numbers
+//
+// Arduino's random(n) goes through the C library's random number
+// generator, and then reduces the result using a modulo, which is a
+// divide.  Effects call it thousands of times when they set up a show,
+// so we provide a faster generator.
+//
+// The generator is Bob Jenkins' small noncryptographic PRNG, the 32-bit
+// version.  It has 128 bits of state, and it takes a handful of adds,
+// xors and rotates per number.  To reduce a number to a range, we use a
+// multiply and a shift instead of a modulo.  This has a tiny bias toward
+// some values, on the order of n/2^32, which is invisible in an effect.
+//
+// Every effect should have its own Prng, obtained from prng_new_stream.
+// Each stream is derived from the master seed, which comes from analog
+// noise at startup.  If you set the master seed to a known value, every
+// show replays exactly the same way.
+//
+
+class Prng {
+private:
+    uint32_t a_, b_, c_, d_;
+
+    static uint32_t rot(uint32_t x, int k) {
+        return (x << k) | (x >> (32 - k));
+    }
+
+public:
+    Prng() { seed(0, 0); }
+    Prng(uint32_t seed_value, uint32_t stream) { seed(seed_value, stream); }
+
+    // seed
+    //
+    // Initialize the generator from a seed and a stream number.
+    // Different streams of the same seed are independent.
+
+    void seed(uint32_t seed_value, uint32_t stream) {
+        a_ = 0xf1ea5eed;
+        b_ = c_ = d_ = seed_value ^ (stream * 0x9E3779B9);
+        for (int i = 0; i < 20; i++) {
+            next();
+        }
+    }
+
+    // next
+    //
+    // Return 32 random bits.
+
+    uint32_t next() {
+        uint32_t e = a_ - rot(b_, 27);
+        a_ = b_ ^ rot(c_, 17);
+        b_ = c_ + d_;
+        c_ = d_ + e;
+        d_ = e + a_;
+        return d_;
+    }
+
+    // below
+    //
+    // Return a number in the range 0 to n-1, without dividing.
+
+    uint32_t below(uint32_t n) {
+        return uint32_t((uint64_t(next()) * n) >> 32);
+    }
+
+    // coin
+    //
+    // Return true half the time.
+
+    bool coin() {
+        return (next() >> 31) != 0;
+    }
+
+    // pick_one
+    //
+    // Return one of the ten values, chosen at random.
+
+    int pick_one(int p0, int p1, int p2, int p3, int p4, int p5, int p6, int p7, int p8, int p9) {
+        int choices[10] = { p0, p1, p2, p3, p4, p5, p6, p7, p8, p9 };
+        return choices[below(10)];
+    }
+
+    // fill_below
+    //
+    // Fill an array with numbers in the range 0 to n-1.
+
+    template <typename T>
+    void fill_below(T *dst, int count, uint32_t n) {
+        for (int i = 0; i < count; i++) {
+            dst[i] = below(n);
+        }
+    }
+};
+
+// Streams.
+//
+
+uint32_t prng_master_seed = 0;
+uint32_t prng_stream_counter = 0;
+
+void prng_seed(uint32_t seed) {
+    prng_master_seed = seed;
+    prng_stream_counter = 0;
+}
+
+Prng prng_new_stream() {
+    return Prng(prng_master_seed, prng_stream_counter++);
+}
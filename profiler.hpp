@@ -0,0 +1,201 @@
+// Cycle Profiler
+//
+// The profiler measures where the frame time goes.  Each frame is
+// divided into four phases:
+//
+//   - render: the effect's update, computing colors.
+//   - convert: converting colors to neopixel format and storing them.
+//   - transmit: handing the frame to the NeoPXL8 driver.
+//   - idle: waiting for the next frame.
+//
+// The main loop and the effects call PROFILE_ENTER at each phase
+// boundary.  The time since the previous boundary is charged to the
+// previous phase.  Effects that convert colors as they go, rather than
+// in a separate pass at the end, have their conversion time charged to
+// render.
+//
+// Phase times are measured using the Cortex-M cycle counter.  At the
+// end of each frame, they are binned into a histogram for the effect
+// that was running.  The histograms are logarithmic, with four buckets
+// per power of two, so percentiles are accurate to within 25%.  The max
+// is exact.  The histograms are printed and cleared on show change.
+//
+// Each phase boundary costs a counter read and a few adds, and each
+// frame costs a few histogram updates.  When PROFILE is 0, all of
+// this compiles to nothing.
+//
+
+#ifndef PROFILE
+#define PROFILE 1
+#endif
+
+// The cycle counter.  This is available even when profiling is off,
+// since the benchmarks use it too.
+//
+
+#if defined(__arm__)
+inline void cycle_counter_begin() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+inline uint32_t cycle_count() { return DWT->CYCCNT; }
+#else
+inline void cycle_counter_begin() {}
+inline uint32_t cycle_count() { return host_cycle_count(); }
+#endif
+
+#if PROFILE
+
+enum ProfilePhase {
+    PROFILE_IDLE,
+    PROFILE_RENDER,
+    PROFILE_CONVERT,
+    PROFILE_TRANSMIT,
+    PROFILE_PHASES
+};
+
+#define PROFILE_MAX_EFFECTS 8
+#define PROFILE_BUCKETS 124
+
+struct ProfileHistogram {
+    uint16_t count_[PROFILE_BUCKETS];
+    uint32_t total_;
+    uint32_t max_;
+
+    // The first four buckets hold 0-3 cycles.  After that, there are
+    // four buckets per power of two.
+
+    static int bucket(uint32_t cycles) {
+        if (cycles < 4) return cycles;
+        int log = 31 - __builtin_clz(cycles);
+        int sub = (cycles >> (log - 2)) & 3;
+        return (log * 4) + sub - 4;
+    }
+
+    static uint32_t bucket_limit(int b) {
+        b += 1;
+        if (b < 4) return b;
+        if (b >= PROFILE_BUCKETS) return 0xFFFFFFFF;
+        int log = (b + 4) >> 2;
+        int sub = (b + 4) & 3;
+        return uint32_t(4 + sub) << (log - 2);
+    }
+
+    void clear() {
+        memset(count_, 0, sizeof(count_));
+        total_ = 0;
+        max_ = 0;
+    }
+
+    void add(uint32_t cycles) {
+        uint16_t &c = count_[bucket(cycles)];
+        if (c != 0xFFFF) c++;
+        total_++;
+        if (cycles > max_) max_ = cycles;
+    }
+
+    // percentile
+    //
+    // Returns the upper limit of the bucket that contains the
+    // specified percentile.
+
+    uint32_t percentile(uint32_t pct) const {
+        uint32_t target = (total_ * pct + 99) / 100;
+        uint32_t seen = 0;
+        for (int b = 0; b < PROFILE_BUCKETS; b++) {
+            seen += count_[b];
+            if (seen >= target) return min(bucket_limit(b), max_);
+        }
+        return max_;
+    }
+};
+
+class Profiler {
+private:
+    ProfileHistogram hist_[PROFILE_MAX_EFFECTS][PROFILE_PHASES];
+    uint32_t frame_[PROFILE_PHASES];
+    uint32_t last_;
+    int phase_;
+    int effect_;
+
+    static uint32_t cycles_to_micros(uint32_t cycles) {
+        return uint64_t(cycles) * 1000000 / F_CPU;
+    }
+
+public:
+    void begin() {
+        cycle_counter_begin();
+        for (int e = 0; e < PROFILE_MAX_EFFECTS; e++) {
+            for (int p = 0; p < PROFILE_PHASES; p++) {
+                hist_[e][p].clear();
+            }
+        }
+        memset(frame_, 0, sizeof(frame_));
+        last_ = cycle_count();
+        phase_ = PROFILE_IDLE;
+        effect_ = -1;
+    }
+
+    // enter
+    //
+    // Charge the time since the last phase boundary to the current
+    // phase, then switch to the specified phase.
+
+    void enter(int phase) {
+        uint32_t now = cycle_count();
+        frame_[phase_] += now - last_;
+        last_ = now;
+        phase_ = phase;
+    }
+
+    // begin_frame
+    //
+    // Finish the previous frame, and bin its phase times.  Then start
+    // rendering a frame of the specified effect.
+
+    void begin_frame(int effect) {
+        enter(PROFILE_RENDER);
+        if ((effect_ >= 0) && (effect_ < PROFILE_MAX_EFFECTS)) {
+            for (int p = 0; p < PROFILE_PHASES; p++) {
+                hist_[effect_][p].add(frame_[p]);
+            }
+        }
+        memset(frame_, 0, sizeof(frame_));
+        effect_ = effect;
+    }
+
+    // report
+    //
+    // Print the histograms for the specified effect, then clear them.
+
+    void report(int effect, const char *name) {
+        static const char *phase_names[PROFILE_PHASES] = { "idle", "render", "convert", "transmit" };
+        if ((effect < 0) || (effect >= PROFILE_MAX_EFFECTS)) return;
+        Serial.printf("Profile of %s (us):\n", name);
+        for (int p = 0; p < PROFILE_PHASES; p++) {
+            ProfileHistogram &hist = hist_[effect][p];
+            Serial.printf("  %-8s p50=%d p99=%d max=%d\n", phase_names[p],
+                int(cycles_to_micros(hist.percentile(50))),
+                int(cycles_to_micros(hist.percentile(99))),
+                int(cycles_to_micros(hist.max_)));
+            hist.clear();
+        }
+    }
+};
+
+Profiler profiler;
+
+#define PROFILE_BEGIN() profiler.begin()
+#define PROFILE_ENTER(phase) profiler.enter(phase)
+#define PROFILE_BEGIN_FRAME(effect) profiler.begin_frame(effect)
+#define PROFILE_REPORT(effect, name) profiler.report(effect, name)
+
+#else
+
+#define PROFILE_BEGIN() do { } while (0)
+#define PROFILE_ENTER(phase) do { } while (0)
+#define PROFILE_BEGIN_FRAME(effect) do { } while (0)
+#define PROFILE_REPORT(effect, name) do { } while (0)
+
+#endif
@@ -0,0 +1,197 @@
+// Projections
+//
+// Many effects compute a one-dimensional signal, such as a ripple that
+// runs from the top of the dodecahedron to the bottom, and then paint
+// it onto the solid.  A projection maps each row of the signal to the
+// list of LEDs that show it.  The effect renders one color per row, and
+// the projection scatters the rows into the frame in a single pass.
+//
+// The tables are generated at compile time, from a map that assigns a
+// row to each LED.  They're stored in the compressed sparse row format:
+// the LEDs of row r are led_[start_[r]] through led_[start_[r+1] - 1].
+// Every LED belongs to exactly one row, so a projection that's scattered
+// every frame repaints the whole frame.
+//
+// There are three maps:
+//
+//   - WaterfallMap: a line of LEDS_PER_HALF * 8 rows, running from the
+//     middle of every top edge down to the middle of every bottom edge,
+//     following the wiring of the strands.
+//
+//   - LongitudeMap: the angle around the north-south axis.
+//
+//   - DistanceMap<V>: the straight-line distance from vertex V.
+//
+// To add a projection, write a map with a 'rows' constant and a
+// constexpr 'row' function.
+//
+
+// led_position
+//
+// The spatial position of an LED.  The LEDs are evenly spaced along each
+// edge, with half a spacing at each end.
+
+constexpr Vector led_position(int led) {
+    int edge = led / LEDS_PER_EDGE;
+    int offset = led % LEDS_PER_EDGE;
+    Vector v1 = dodecahedron_vertex[dodecahedron_edge[edge].vertex1];
+    Vector v2 = dodecahedron_vertex[dodecahedron_edge[edge].vertex2];
+    int32_t num = offset * 2 + 1;
+    int32_t den = LEDS_PER_EDGE * 2;
+    return Vector(v1.X + (v2.X - v1.X) * num / den,
+                  v1.Y + (v2.Y - v1.Y) * num / den,
+                  v1.Z + (v2.Z - v1.Z) * num / den);
+}
+
+// WaterfallMap
+//
+// Each strand runs from a top edge, down to the bottom, and back up one
+// edge.  In terms of the edges of a strand, the waterfall covers:
+//
+//   rows   0-14:  edge 0, from the middle outward, both directions
+//   rows  15-44:  edge 1
+//   rows  45-74:  edge 2, and edge 5 backward
+//   rows  75-104: edge 3
+//   rows 105-119: edge 4, from both ends toward the middle
+//
+
+struct WaterfallMap {
+    static constexpr int rows = LEDS_PER_HALF * 8;
+
+    static constexpr int row(int led) {
+        int edge = (led / LEDS_PER_EDGE) % EDGES_PER_STRAND;
+        int offset = led % LEDS_PER_EDGE;
+        switch (edge) {
+        case 0: return (offset < LEDS_PER_HALF) ? (LEDS_PER_HALF - 1 - offset) : (offset - LEDS_PER_HALF);
+        case 1: return LEDS_PER_HALF + offset;
+        case 2: return LEDS_PER_HALF * 3 + offset;
+        case 3: return LEDS_PER_HALF * 5 + offset;
+        case 4: return (offset < LEDS_PER_HALF) ? (LEDS_PER_HALF * 7 + offset) : (LEDS_PER_HALF * 9 - 1 - offset);
+        default: return LEDS_PER_HALF * 5 - 1 - offset;
+        }
+    }
+};
+
+// LongitudeMap
+//
+// The angle uses an octant-reduced arctangent approximation, which is
+// accurate to about a quarter of a degree, much finer than a row.
+
+constexpr int32_t approx_atan_turns(int32_t num, int32_t den) {
+    // atan(z) ~= z * (pi/4 + 0.273 * (1 - z)), for z in [0, 1], in
+    // units of 1/32768 of a turn.
+    int64_t z = (int64_t(num) << 16) / den;
+    return int32_t((z * (4096 + ((1424 * (65536 - z)) >> 16))) >> 16);
+}
+
+constexpr int32_t approx_angle(int32_t x, int32_t y) {
+    int32_t ax = (x < 0) ? -x : x;
+    int32_t ay = (y < 0) ? -y : y;
+    if (ax == 0 && ay == 0) return 0;
+    int32_t a = (ay <= ax) ? approx_atan_turns(ay, ax) : (8192 - approx_atan_turns(ax, ay));
+    if (x < 0) a = 16384 - a;
+    if (y < 0) a = 32768 - a;
+    return a & 0x7FFF;
+}
+
+struct LongitudeMap {
+    static constexpr int rows = 120;
+
+    static constexpr int row(int led) {
+        Vector p = led_position(led);
+        return (approx_angle(p.X, p.Y) * rows) >> 15;
+    }
+};
+
+// DistanceMap
+//
+// The rows divide the diameter of the dodecahedron evenly, so the last
+// row is the vertex opposite V.
+
+constexpr int32_t isqrt(int64_t n) {
+    int64_t lo = 0;
+    int64_t hi = 1 << 20;
+    while (lo < hi) {
+        int64_t mid = (lo + hi + 1) >> 1;
+        if (mid * mid <= n) lo = mid; else hi = mid - 1;
+    }
+    return int32_t(lo);
+}
+
+constexpr int32_t vector_length(const Vector &v) {
+    return isqrt(int64_t(v.X) * v.X + int64_t(v.Y) * v.Y + int64_t(v.Z) * v.Z);
+}
+
+template <int V>
+struct DistanceMap {
+    static_assert(V >= 0 && V < 20, "No such vertex.");
+    static constexpr int rows = 120;
+
+    static constexpr int row(int led) {
+        Vector focus = dodecahedron_vertex[V];
+        int32_t diameter = vector_length(focus) * 2;
+        int32_t distance = vector_length(led_position(led).sub(focus));
+        int r = distance * rows / diameter;
+        return (r < rows) ? r : (rows - 1);
+    }
+};
+
+// Projection
+//
+// The table for a map, built at compile time by a counting sort of
+// the LEDs by row.
+
+template <typename Map>
+struct Projection {
+    static constexpr int rows = Map::rows;
+
+    uint16_t start_[rows + 1];
+    uint16_t led_[TOTAL_LEDS];
+
+    constexpr Projection() : start_(), led_() {
+        for (int i = 0; i < TOTAL_LEDS; i++) {
+            start_[Map::row(i) + 1]++;
+        }
+        for (int r = 0; r < rows; r++) {
+            start_[r + 1] += start_[r];
+        }
+        uint16_t fill[rows] = {};
+        for (int i = 0; i < TOTAL_LEDS; i++) {
+            int r = Map::row(i);
+            led_[start_[r] + fill[r]] = i;
+            fill[r]++;
+        }
+    }
+
+    constexpr int row_size(int row) const {
+        return start_[row + 1] - start_[row];
+    }
+
+    // Paint one row.
+
+    void scatter_row(int row, const RGB &color) const {
+        for (int k = start_[row]; k < start_[row + 1]; k++) {
+            led_frame[led_[k]] = color;
+        }
+    }
+
+    // Paint every row, from an array with one color per row.
+
+    void scatter(const RGB *colors) const {
+        int k = 0;
+        for (int row = 0; row < rows; row++) {
+            RGB color = colors[row];
+            int end = start_[row + 1];
+            for (; k < end; k++) {
+                led_frame[led_[k]] = color;
+            }
+        }
+    }
+};
+
+constexpr Projection<WaterfallMap> waterfall_projection;
+constexpr Projection<LongitudeMap> longitude_projection;
+
+static_assert(waterfall_projection.row_size(0) == TOTAL_STRANDS * 2, "Waterfall starts in the middle of the top edges.");
+static_assert(waterfall_projection.row_size(LEDS_PER_HALF) == TOTAL_STRANDS, "Waterfall follows one edge per strand.");
+static_assert(waterfall_projection.row_size(LEDS_PER_HALF * 3) == TOTAL_STRANDS * 2, "Waterfall meets the return edge.");
@@ -1,27 +1,42 @@
+// The rug starts out even, every LED follows the same rule, and the
+// hotspot circles one face, so the rug looks the same when spun around
+// the axis through that face.  It runs on the rows of face_symmetry,
+// with the hotspot around the face on the right of SYMMETRY_FACE_EDGE,
+// which is a fifth of the LEDs.  A rotation about the pole carries the
+// rows to the face that the rug picked.
+
 struct RugEffect {
-    Rainbow rainbow_;
-    fixed data_[TOTAL_LEDS];
-    fixed next_[TOTAL_LEDS];
+    RainbowPalette base_;
+    RainbowPalette palette_;
+    fixed palette_scale_;
+    fixed data_[face_symmetry.rows];
+    fixed next_[face_symmetry.rows];
+    RGB rows_[face_symmetry.rows];
+    uint16_t leds_[TOTAL_LEDS];
     int peak_aggressiveness_;
     int focal_edge_;
+    Prng rng_;
+
+    static const char *name() { return "RugEffect"; }
     
     RugEffect() {
-        for (int x = 0; x < TOTAL_LEDS; x++) {
-            data_[x] = 1000;
+        rng_ = prng_new_stream();
+        for (int r = 0; r < face_symmetry.rows; r++) {
+            data_[r] = 1000;
         }
-        peak_aggressiveness_ = 5 << random(4);
+        peak_aggressiveness_ = 5 << rng_.below(4);
         Serial.printf("Peak agg = %d\n", peak_aggressiveness_);
-        int hue_gap = 4000 + random(8000);
-        int hue1 = random(FIXMAX);
+        int hue_gap = 4000 + rng_.below(8000);
+        int hue1 = rng_.below(FIXMAX);
         int hue2 = (hue1 + hue_gap) & 0x7FFF;
         int hue3 = (hue1 + (hue_gap >> 1) + FIXHALF) & 0x7FFF;
-        if (random(2) == 0) {
+        if (rng_.coin()) {
             int t=hue1; hue1=hue2; hue2=t;
         }
         RGB color1 = hue_sat(hue1, FIXMAX).brighten();
         RGB color2 = hue_sat(hue2, FIXMAX).brighten();
         RGB color3 = hue_sat(hue3, FIXMAX).brighten();
-        switch(random(5)) {
+        switch(rng_.below(5)) {
         case 0: break; // No desaturation.
         case 1: color1 = RGB(FIXMAX, FIXMAX, FIXMAX); break;
         case 2: color2 = RGB(FIXMAX, FIXMAX, FIXMAX); break;
@@ -31,23 +46,32 @@ struct RugEffect {
             color2 = color2.desaturate(FIXHALF);
             break;
         }
-        focal_edge_ = (random(5) * EDGES_PER_STRAND) + 4;
+        focal_edge_ = (rng_.below(5) * EDGES_PER_STRAND) + SYMMETRY_FACE_EDGE;
+        for (int g = 0; g < ROTATIONS; g++) {
+            if (!symmetry_contains(SYMMETRY_POLE, g)) continue;
+            if (rotation_table.rotate(g, DirectedEdge(SYMMETRY_FACE_EDGE, false)).edge != focal_edge_) continue;
+            face_symmetry.rotated_leds(g, leds_);
+        }
            
         RGB black(0,0,0);
-        rainbow_.clear();
-        rainbow_.add_range(3, black, black);
-        rainbow_.add_range(2, black, color1);
-        rainbow_.add_range(random(4) + 1, color1, color1);
-        rainbow_.add_range(random(10) + 1, color1, color2);
-        rainbow_.add_range(random(4) + 1, color2, color2);
-        if (random(2) == 0) {
-            rainbow_.add_range(1, color2, color3);
+        Rainbow rainbow;
+        rainbow.clear();
+        rainbow.add_range(3, black, black);
+        rainbow.add_range(2, black, color1);
+        rainbow.add_range(rng_.below(4) + 1, color1, color1);
+        rainbow.add_range(rng_.below(10) + 1, color1, color2);
+        rainbow.add_range(rng_.below(4) + 1, color2, color2);
+        if (rng_.coin()) {
+            rainbow.add_range(1, color2, color3);
         } else {
-            rainbow_.add_range(1, color2, black);
-            rainbow_.add_range(1, black, color3);
+            rainbow.add_range(1, color2, black);
+            rainbow.add_range(1, black, color3);
         }
-        rainbow_.add_range(random(3) + 1, color3, color3);
-        rainbow_.add_range(1, color3, black);
+        rainbow.add_range(rng_.below(3) + 1, color3, color3);
+        rainbow.add_range(1, color3, black);
+        rainbow.bake(base_);
+        palette_ = base_;
+        palette_scale_ = FIXMAX;
     }
     
     bool update() {
@@ -56,36 +80,41 @@ struct RugEffect {
         int aggressiveness = 3 + fixed_mul(peak_aggressiveness_, agg_ramp);
         int forcing =        spline8(age,  20, 10,   5,   2,   0,   0,   0,  0, 0);
         int fade_black =     spline8(age,  0, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, FIXMAX, 0);
-        for (int edge = 0; edge < TOTAL_EDGES; edge++) {
-            for (int offset = 0; offset < LEDS_PER_EDGE; offset++) {
-                AdjacentLEDs adj(edge, offset);
-                int self_index = edge_forward(edge, offset);
-                int self_data = data_[self_index];
-                int average;
-                if (adj.have_three()) {
-                    average = data_[adj.led[0]] + data_[adj.led[1]] + data_[adj.led[2]] + self_data;
-                } else {
-                    average = data_[adj.led[0]] + data_[adj.led[1]] + self_data + self_data;
-                }
-                average += self_data * 4;
-                average = average >> 3;
-                next_[self_index] = (average - aggressiveness) & 0x7FFF;
+        // Each LED moves toward the average of itself and its neighbors.
+        // An LED with only two neighbors counts itself twice.
+        for (int r = 0; r < face_symmetry.rows; r++) {
+            int x = face_symmetry.domain(r);
+            const uint16_t *adj = led_adjacency.neighbors(x);
+            int self_data = data_[r];
+            int average = data_[face_symmetry.row(adj[0])] + data_[face_symmetry.row(adj[1])] + self_data;
+            if (led_adjacency.count(x) == 3) {
+                average += data_[face_symmetry.row(adj[2])];
+            } else {
+                average += self_data;
             }
+            average += self_data * 4;
+            average = average >> 3;
+            next_[r] = (average - aggressiveness) & 0x7FFF;
         }
-        DirectedEdge hotspot(focal_edge_, 0);
-        for (int i = 0; i < 5; i ++) {
-            next_[hotspot.offset(14)] -= forcing;
-            next_[hotspot.offset(15)] -= forcing;
-            hotspot = hotspot.successor(false);
-        }
+        // The hotspot is the middle of each edge around the face, which
+        // is two rows.
+        DirectedEdge hotspot(SYMMETRY_FACE_EDGE, false);
+        next_[face_symmetry.row(hotspot.offset(14))] -= forcing;
+        next_[face_symmetry.row(hotspot.offset(15))] -= forcing;
                 
-        for (int x = 0; x < TOTAL_LEDS; x++) {
-            data_[x] = next_[x];
-            int rain = (data_[x] << 2) & 0x7FFF;
-            RGB rgb = rainbow_.get(rain);
-            uint32_t neocolor = rgb.scale(fade_black).neocolor_unsafe();
-            leds.setPixelColor(x, neocolor);
+        // The fade only changes at the start and end of the show, so
+        // the palette is rarely rebaked.
+        if (fade_black != palette_scale_) {
+            rgb_scale_span(palette_.color, base_.color, fade_black, RAINBOW_PALETTE_SIZE);
+            palette_scale_ = fade_black;
+        }
+
+        for (int r = 0; r < face_symmetry.rows; r++) {
+            data_[r] = next_[r];
+            rows_[r] = palette_.get(data_[r] << 2);
         }
+        PROFILE_ENTER(PROFILE_CONVERT);
+        symmetry_scatter(leds_, face_symmetry.rows, face_symmetry.order, rows_);
 
         return (age < FIXMAX);
     }
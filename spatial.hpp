@@ -0,0 +1,197 @@
+// Spatial Queries
+//
+// Effects that paint in space, rather than along the strands, need the
+// position of every LED.  led_positions holds them in flash, as three
+// arrays of int16, one per axis, so a pass over the whole solid reads
+// memory in order and does a multiply-accumulate per axis per LED.
+// led_dot_span and led_distance_sq_span are those passes: the distance
+// of every LED from a plane, or the squared distance from a point.
+//
+// Most geometric shapes only light a few LEDs, though, and a pass over
+// all 900 wastes most of its work.  The spatial index is a bounding
+// sphere around each edge.  A query tests the 30 spheres, skips the
+// edges that are entirely outside the shape, copies the edges that are
+// entirely inside, and checks each LED only on the edges that cross the
+// boundary.  The cost is about the size of the output, plus 30 sphere
+// tests, plus 30 LEDs for each edge that the boundary cuts.
+//
+// The queries write the indices of the LEDs they select into a buffer,
+// which must have room for TOTAL_LEDS, in increasing order, and return
+// the count.  They give exactly the same LEDs as testing every entry of
+// led_positions.
+//
+
+// LedPositions
+//
+// led_position for every LED, rounded the same way.  Coordinates range
+// from -16384 to 16384, so they fit in an int16.
+
+struct LedPositions {
+    int16_t X[TOTAL_LEDS];
+    int16_t Y[TOTAL_LEDS];
+    int16_t Z[TOTAL_LEDS];
+
+    constexpr LedPositions() : X(), Y(), Z() {
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            Vector p = led_position(led);
+            X[led] = p.X;
+            Y[led] = p.Y;
+            Z[led] = p.Z;
+        }
+    }
+
+    constexpr Vector get(int led) const {
+        return Vector(X[led], Y[led], Z[led]);
+    }
+};
+
+constexpr LedPositions led_positions;
+
+// EdgeBounds
+//
+// The center of each edge, halfway between its first and last LEDs,
+// and the radius of a sphere around the center that holds every LED
+// of the edge.
+
+struct EdgeBound {
+    int16_t X;
+    int16_t Y;
+    int16_t Z;
+    int16_t radius;
+};
+
+struct EdgeBounds {
+    EdgeBound edge[TOTAL_EDGES];
+
+    constexpr EdgeBounds() : edge() {
+        for (int e = 0; e < TOTAL_EDGES; e++) {
+            int first = e * LEDS_PER_EDGE;
+            Vector a = led_positions.get(first);
+            Vector b = led_positions.get(first + LEDS_PER_EDGE - 1);
+            Vector center((a.X + b.X) / 2, (a.Y + b.Y) / 2, (a.Z + b.Z) / 2);
+            int32_t radius = 0;
+            for (int led = first; led < first + LEDS_PER_EDGE; led++) {
+                int32_t d = vector_length(led_positions.get(led).sub(center)) + 1;
+                radius = (d > radius) ? d : radius;
+            }
+            edge[e].X = center.X;
+            edge[e].Y = center.Y;
+            edge[e].Z = center.Z;
+            edge[e].radius = radius;
+        }
+    }
+};
+
+constexpr EdgeBounds edge_bounds;
+
+// led_dot_span
+//
+// dst[led] = n.dot(position of led), for every LED.  Comparing the
+// result to a constant splits the solid with a plane.  The components
+// of n must be within +/-32767, so the sums fit in an int32.
+
+inline void led_dot_span(int32_t *dst, const Vector &n) {
+    const int16_t *x = led_positions.X;
+    const int16_t *y = led_positions.Y;
+    const int16_t *z = led_positions.Z;
+    int32_t nx = n.X, ny = n.Y, nz = n.Z;
+    for (int led = 0; led < TOTAL_LEDS; led++) {
+        dst[led] = x[led] * nx + y[led] * ny + z[led] * nz;
+    }
+}
+
+// led_distance_sq_span
+//
+// dst[led] = the squared distance from p to the LED, for every LED.  p
+// must be within the cube that holds the solid, +/-16384 on each axis,
+// so the squares fit in a uint32.
+
+inline void led_distance_sq_span(uint32_t *dst, const Vector &p) {
+    const int16_t *x = led_positions.X;
+    const int16_t *y = led_positions.Y;
+    const int16_t *z = led_positions.Z;
+    int32_t px = p.X, py = p.Y, pz = p.Z;
+    for (int led = 0; led < TOTAL_LEDS; led++) {
+        int32_t dx = x[led] - px;
+        int32_t dy = y[led] - py;
+        int32_t dz = z[led] - pz;
+        dst[led] = uint32_t(dx * dx) + uint32_t(dy * dy) + uint32_t(dz * dz);
+    }
+}
+
+// leds_within
+//
+// Select the LEDs within distance r of p, inclusive.  As with
+// led_distance_sq_span, p must be within +/-16384 on each axis.
+
+inline int leds_within(uint16_t *out, const Vector &p, int32_t r) {
+    if (r < 0) return 0;
+    // No LED is farther than this from a point in the cube.
+    if (r > 56755) r = 56755;
+    uint32_t r2 = uint32_t(r) * uint32_t(r);
+    const int16_t *x = led_positions.X;
+    const int16_t *y = led_positions.Y;
+    const int16_t *z = led_positions.Z;
+    int count = 0;
+    for (int e = 0; e < TOTAL_EDGES; e++) {
+        const EdgeBound &bound = edge_bounds.edge[e];
+        int64_t dx = bound.X - p.X;
+        int64_t dy = bound.Y - p.Y;
+        int64_t dz = bound.Z - p.Z;
+        int64_t d2 = dx * dx + dy * dy + dz * dz;
+        int64_t outer = r + bound.radius;
+        if (d2 > outer * outer) continue;
+        int first = e * LEDS_PER_EDGE;
+        int64_t inner = r - bound.radius;
+        if ((inner >= 0) && (d2 <= inner * inner)) {
+            for (int led = first; led < first + LEDS_PER_EDGE; led++) out[count++] = led;
+            continue;
+        }
+        for (int led = first; led < first + LEDS_PER_EDGE; led++) {
+            int32_t lx = x[led] - p.X;
+            int32_t ly = y[led] - p.Y;
+            int32_t lz = z[led] - p.Z;
+            uint32_t l2 = uint32_t(lx * lx) + uint32_t(ly * ly) + uint32_t(lz * lz);
+            if (l2 <= r2) out[count++] = led;
+        }
+    }
+    return count;
+}
+
+// leds_between
+//
+// Select the LEDs with lo <= n.dot(position) <= hi: the slab between
+// two parallel planes.  As with led_dot_span, the components of n must
+// be within +/-32767.
+//
+// The dot product is linear along an edge, so its range over the edge
+// is set by the end LEDs, widened by the rounding of the positions in
+// between, which is under two units on each axis.
+
+inline int leds_between(uint16_t *out, const Vector &n, int32_t lo, int32_t hi) {
+    if (lo > hi) return 0;
+    const int16_t *x = led_positions.X;
+    const int16_t *y = led_positions.Y;
+    const int16_t *z = led_positions.Z;
+    int32_t nx = n.X, ny = n.Y, nz = n.Z;
+    int32_t slack = 2 * (abs(nx) + abs(ny) + abs(nz));
+    int count = 0;
+    for (int e = 0; e < TOTAL_EDGES; e++) {
+        int first = e * LEDS_PER_EDGE;
+        int last = first + LEDS_PER_EDGE - 1;
+        int32_t d0 = x[first] * nx + y[first] * ny + z[first] * nz;
+        int32_t d1 = x[last] * nx + y[last] * ny + z[last] * nz;
+        int64_t dmin = int64_t((d0 < d1) ? d0 : d1) - slack;
+        int64_t dmax = int64_t((d0 < d1) ? d1 : d0) + slack;
+        if ((dmax < lo) || (dmin > hi)) continue;
+        if ((dmin >= lo) && (dmax <= hi)) {
+            for (int led = first; led <= last; led++) out[count++] = led;
+            continue;
+        }
+        for (int led = first; led <= last; led++) {
+            int32_t d = x[led] * nx + y[led] * ny + z[led] * nz;
+            if ((d >= lo) && (d <= hi)) out[count++] = led;
+        }
+    }
+    return count;
+}
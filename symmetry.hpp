@@ -0,0 +1,285 @@
+// Rotational Symmetry
+//
+// The dodecahedron has 60 rotations that map it onto itself.  A rotation
+// maps each directed edge onto another one, and keeps left and right,
+// so it's fixed by where it sends a single directed edge.  Rotation g is
+// the one that sends directed edge 0 forward to packed edge g.  The
+// compiler follows the successor table outward from there, and stores
+// the image of every edge, and of every vertex, in rotation_table.
+//
+// Many effects look the same under some of the rotations.  BurstEffect
+// looks the same under all of them: every edge shows the same pattern,
+// mirrored around its middle.  Other effects only look the same when
+// spun around an axis.  RugEffect's hotspot circles one face, so the
+// rug looks the same when spun around the axis through that face.  A
+// Symmetry is a table for one group of rotations:
+//
+//   - SYMMETRY_ALL: all 60 rotations.
+//   - SYMMETRY_POLE: the 5 rotations about the north-south axis, which
+//     runs through the middles of the top and bottom faces.
+//   - SYMMETRY_FACE: the 5 rotations about the axis through the face on
+//     the right of edge 4, run forward.
+//   - SYMMETRY_VERTEX: the 3 rotations about the axis through vertex 0.
+//   - SYMMETRY_EDGE: the 2 rotations about the axis through the middle
+//     of edge 0.
+//
+// No LED sits on any of the axes, so a group of order N splits the LEDs
+// into orbits of exactly N, and an effect with that symmetry only has
+// to compute one LED per orbit: the fundamental domain.  The effect
+// renders one color per row, where domain(row) is the LED that the row
+// stands for, and scatter fills the frame, like a projection.  row(led)
+// goes the other way, so an effect can find the rows of an LED's
+// neighbors.
+//
+// The same group about a different axis is the group conjugated by a
+// rotation.  rotated_leds gives the LED lists for that, and
+// symmetry_scatter paints from them.  This is how the rug spins around
+// whichever face it picked.
+//
+
+#define ROTATIONS PACKED_EDGES
+#define DODECAHEDRON_VERTICES 20
+#define SYMMETRY_FACE_EDGE 4
+
+struct RotationTable {
+    PackedEdge edge[ROTATIONS][TOTAL_EDGES];
+    uint8_t vertex[ROTATIONS][DODECAHEDRON_VERTICES];
+
+    constexpr RotationTable() : edge(), vertex() {
+        for (int g = 0; g < ROTATIONS; g++) {
+            PackedEdge image[PACKED_EDGES] = {};
+            PackedEdge queue[PACKED_EDGES] = {};
+            for (int packed = 0; packed < PACKED_EDGES; packed++) image[packed] = NO_PACKED_EDGE;
+            image[0] = g;
+            int count = 1;
+            for (int head = 0; head < count; head++) {
+                DirectedEdge from = DirectedEdge::unpack(queue[head]);
+                DirectedEdge to = DirectedEdge::unpack(image[queue[head]]);
+                DirectedEdge next_from[3] = { from.successor(false), from.successor(true), from.uturn() };
+                DirectedEdge next_to[3] = { to.successor(false), to.successor(true), to.uturn() };
+                for (int k = 0; k < 3; k++) {
+                    PackedEdge packed = next_from[k].pack();
+                    if (image[packed] != NO_PACKED_EDGE) continue;
+                    image[packed] = next_to[k].pack();
+                    queue[count++] = packed;
+                }
+            }
+            for (int e = 0; e < TOTAL_EDGES; e++) {
+                DirectedEdge to = DirectedEdge::unpack(image[DirectedEdge(e, false).pack()]);
+                edge[g][e] = to.pack();
+                vertex[g][dodecahedron_edge[e].vertex1] = to.vertex1_index();
+                vertex[g][dodecahedron_edge[e].vertex2] = to.vertex2_index();
+            }
+        }
+    }
+
+    // Every rotation permutes the edges, and keeps the successors of
+    // every directed edge on the same sides.
+
+    constexpr bool valid() const {
+        for (int g = 0; g < ROTATIONS; g++) {
+            bool seen[TOTAL_EDGES] = {};
+            for (int e = 0; e < TOTAL_EDGES; e++) {
+                int to = edge[g][e] >> 1;
+                if (seen[to]) return false;
+                seen[to] = true;
+            }
+            for (int packed = 0; packed < PACKED_EDGES; packed++) {
+                DirectedEdge from = DirectedEdge::unpack(packed);
+                for (int left = 0; left < 2; left++) {
+                    if (rotate(g, from.successor(left)).pack() != rotate(g, from).successor(left).pack()) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    constexpr DirectedEdge rotate(int g, const DirectedEdge &from) const {
+        return from.backward ? DirectedEdge::unpack(edge[g][from.edge]).uturn() : DirectedEdge::unpack(edge[g][from.edge]);
+    }
+};
+
+constexpr RotationTable rotation_table;
+
+static_assert(rotation_table.valid(), "Every rotation is a symmetry of the dodecahedron.");
+
+constexpr int rotate_led(int g, int led) {
+    return DirectedEdge::unpack(rotation_table.edge[g][led / LEDS_PER_EDGE]).offset(led % LEDS_PER_EDGE);
+}
+
+constexpr int rotate_vertex(int g, int v) {
+    return rotation_table.vertex[g][v];
+}
+
+enum SymmetryGroup {
+    SYMMETRY_ALL,
+    SYMMETRY_POLE,
+    SYMMETRY_FACE,
+    SYMMETRY_VERTEX,
+    SYMMETRY_EDGE
+};
+
+// A path that always turns right circles the face on its right.
+
+constexpr bool face_has_vertex(const DirectedEdge &start, int v) {
+    DirectedEdge e = start;
+    for (int i = 0; i < 5; i++) {
+        if (e.vertex1_index() == v) return true;
+        e = e.successor(false);
+    }
+    return false;
+}
+
+constexpr bool symmetry_contains(SymmetryGroup group, int g) {
+    switch (group) {
+    case SYMMETRY_POLE:
+        // The top face is vertices 15 through 19.
+        for (int v = 15; v < DODECAHEDRON_VERTICES; v++) {
+            if (rotate_vertex(g, v) < 15) return false;
+        }
+        return true;
+    case SYMMETRY_FACE:
+        for (int v = 0; v < DODECAHEDRON_VERTICES; v++) {
+            if (face_has_vertex(DirectedEdge(SYMMETRY_FACE_EDGE, false), v) &&
+                !face_has_vertex(DirectedEdge(SYMMETRY_FACE_EDGE, false), rotate_vertex(g, v))) return false;
+        }
+        return true;
+    case SYMMETRY_VERTEX:
+        return rotate_vertex(g, 0) == 0;
+    case SYMMETRY_EDGE:
+        return (rotation_table.edge[g][0] >> 1) == 0;
+    default:
+        return true;
+    }
+}
+
+constexpr int symmetry_order(SymmetryGroup group) {
+    int order = 0;
+    for (int g = 0; g < ROTATIONS; g++) {
+        if (symmetry_contains(group, g)) order++;
+    }
+    return order;
+}
+
+// symmetry_scatter
+//
+// Paint every row, from an array with one color per row.  The LEDs of
+// row r are led[r * order] through led[r * order + order - 1].
+
+inline void symmetry_scatter(const uint16_t *led, int rows, int order, const RGB *colors) {
+    for (int row = 0; row < rows; row++) {
+        RGB color = colors[row];
+        for (int i = 0; i < order; i++) {
+            led_frame[*led++] = color;
+        }
+    }
+}
+
+// Symmetry
+//
+// The LEDs of row r are led_[r * order] through led_[r * order + order - 1],
+// and the first of them is the lowest numbered LED in the orbit, which
+// is the row's domain LED.  row_[led] is the row that the LED is in.
+
+template <SymmetryGroup Group>
+struct Symmetry {
+    static constexpr int order = symmetry_order(Group);
+    static constexpr int rows = TOTAL_LEDS / order;
+
+    uint16_t led_[TOTAL_LEDS];
+    uint16_t row_[TOTAL_LEDS];
+
+    constexpr Symmetry() : led_(), row_() {
+        int rotation[ROTATIONS] = {};
+        int n = 0;
+        for (int g = 0; g < ROTATIONS; g++) {
+            if (symmetry_contains(Group, g)) rotation[n++] = g;
+        }
+        bool seen[TOTAL_LEDS] = {};
+        int k = 0;
+        for (int led = 0; led < TOTAL_LEDS; led++) {
+            if (seen[led]) continue;
+            for (int i = 0; i < n; i++) {
+                int to = rotate_led(rotation[i], led);
+                seen[to] = true;
+                if (k < TOTAL_LEDS) led_[k] = to;
+                row_[to] = k / n;
+                k++;
+            }
+        }
+    }
+
+    // Every LED is in exactly one row.
+
+    constexpr bool complete() const {
+        bool seen[TOTAL_LEDS] = {};
+        for (int k = 0; k < TOTAL_LEDS; k++) {
+            if (seen[led_[k]]) return false;
+            seen[led_[k]] = true;
+        }
+        return true;
+    }
+
+    constexpr int domain(int row) const {
+        return led_[row * order];
+    }
+
+    constexpr int row(int led) const {
+        return row_[led];
+    }
+
+    // Under the full group, row r is LED r of every edge, and its mirror
+    // image, LED LEDS_PER_EDGE - 1 - r.
+
+    constexpr bool mirrors_edges() const {
+        for (int k = 0; k < TOTAL_LEDS; k++) {
+            int offset = led_[k] % LEDS_PER_EDGE;
+            int r = k / order;
+            if ((offset != r) && (offset != LEDS_PER_EDGE - 1 - r)) return false;
+        }
+        return true;
+    }
+
+    // Paint every row, from an array with one color per row.  Under the
+    // full group every edge is the same, so edge 0 is painted and copied.
+
+    void scatter(const RGB *colors) const {
+        if (Group == SYMMETRY_ALL) {
+            for (int r = 0; r < rows; r++) {
+                led_frame[r] = colors[r];
+                led_frame[LEDS_PER_EDGE - 1 - r] = colors[r];
+            }
+            for (int e = 1; e < TOTAL_EDGES; e++) {
+                led_copy_span(e * LEDS_PER_EDGE, 0, LEDS_PER_EDGE);
+            }
+            return;
+        }
+        symmetry_scatter(led_, rows, order, colors);
+    }
+
+    // rotated_leds
+    //
+    // The LED lists for the same group about the axis that rotation g
+    // carries this one's to.  'led' must have room for TOTAL_LEDS.
+
+    void rotated_leds(int g, uint16_t *led) const {
+        for (int k = 0; k < TOTAL_LEDS; k++) {
+            led[k] = rotate_led(g, led_[k]);
+        }
+    }
+};
+
+constexpr Symmetry<SYMMETRY_ALL> full_symmetry;
+constexpr Symmetry<SYMMETRY_POLE> pole_symmetry;
+constexpr Symmetry<SYMMETRY_FACE> face_symmetry;
+constexpr Symmetry<SYMMETRY_VERTEX> vertex_symmetry;
+constexpr Symmetry<SYMMETRY_EDGE> edge_symmetry;
+
+static_assert(full_symmetry.order == 60 && pole_symmetry.order == 5 && face_symmetry.order == 5 &&
+    vertex_symmetry.order == 3 && edge_symmetry.order == 2,
+    "The rotation groups have the expected orders.");
+static_assert(full_symmetry.complete() && pole_symmetry.complete() && face_symmetry.complete() &&
+    vertex_symmetry.complete() && edge_symmetry.complete(),
+    "No LED is on a rotation axis.");
+static_assert((full_symmetry.rows == LEDS_PER_HALF) && full_symmetry.mirrors_edges(),
+    "The full group's rows are the mirrored halves of the edges.");
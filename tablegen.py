@@ -263,3 +263,19 @@ def print_edges(e):
         sys.stdout.write("\n")
         
 
+
+# The gamma table maps a 15-bit linear channel, in steps of 128, to an
+# 8.8 fixed-point output level.  The largest entry is 255 << 8, so that
+# adding a dither error of up to 255 can't overflow 16 bits.  There are
+# 258 entries so that interpolation never reads past the end.
+GAMMA=2.2
+
+def gen_gamma_table():
+    print "const uint16_t gamma_table[LED_GAMMA_ENTRIES] = {"
+    for row in range(0, 258, 8):
+        sys.stdout.write("   ")
+        for i in range(row, min(row + 8, 258)):
+            x = min(i, 256) / 256.0
+            sys.stdout.write(" %5d," % int(round(math.pow(x, GAMMA) * 255 * 256)))
+        sys.stdout.write("\n")
+    print "};"
@@ -3,25 +3,25 @@ struct Vector {
     int32_t Y;
     int32_t Z;
     
-    Vector(int32_t x, int32_t y, int32_t z) : X(x), Y(y), Z(z) {}
+    constexpr Vector(int32_t x, int32_t y, int32_t z) : X(x), Y(y), Z(z) {}
     
-    Vector negate() const {
+    constexpr Vector negate() const {
         return Vector(-X, -Y, -Z);
     }
     
-    Vector div(int n) const {
+    constexpr Vector div(int n) const {
         return Vector(X / n, Y / n, Z / n);
     }
     
-    Vector add(const Vector &other) const {
+    constexpr Vector add(const Vector &other) const {
         return Vector(X + other.X, Y + other.Y, Z + other.Z);
     }
     
-    Vector sub(const Vector &other) const {
+    constexpr Vector sub(const Vector &other) const {
         return Vector(X - other.X, Y - other.Y, Z - other.Z);
     }
     
-    Vector cross(const Vector &other) const {
+    constexpr Vector cross(const Vector &other) const {
         return Vector(Y*other.Z - Z*other.Y, Z*other.X - X*other.Z, X*other.Y - Y*other.X);
     }
     
@@ -31,7 +31,7 @@ struct Vector {
                       ::fixed_lerp(Z, other.Z, offset));
     }
     
-    int32_t dot(const Vector &other) const {
+    constexpr int32_t dot(const Vector &other) const {
         return X*other.X + Y*other.Y + Z*other.Z;
     }
 };